@@ -1,47 +1,172 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <random>
 #include <cstring>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <sstream>
 #include <string>
-#include <filesystem>
+#include <string_view>
 #include <fstream>
 #include <stdio.h>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <iostream>
 #include <ncurses.h>
 #include <unistd.h>
 #include <pwd.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
-namespace fs = std::filesystem;
+#include <sys/un.h>
 
+//the state letter of /stat and /status
+enum class ProcessState : char {
+    RUNNING = 'R',
+    SLEEPING = 'S',
+    DISK_SLEEP = 'D',
+    STOPPED = 'T',
+    TRACING_STOP = 't',
+    DEAD = 'X',
+    ZOMBIE = 'Z',
+    PARKED = 'P',
+    IDLE = 'I',
+    UNKNOWN = '?'
+};
+
+//the strings are interned in pools shared by every process, so a process is about 100 bytes without heap data
 struct Process {
-    std::string name;
+    std::string_view name; //interned in the name pool
+    std::string_view processPath = "none"; //interned in the exe path cache
+    std::string_view userName = "none"; //interned in the user cache
     int pid = -1; //process id
     int ppid = -1; //parent process id
     int threads = 1;
     int ramUsage = -1; //VmRSS
     int swapUsage = -1; //VmSwap
     int numFileDescriptors = -1; //FDsize
-    std::string state = "none"; //R/S/D/Z/T
-    std::string processPath = "none";
     int uid = -1;
-    std::string userName = "none";
+    ProcessState state = ProcessState::UNKNOWN; //R/S/D/Z/T
+    float cpuUsage = 0; //percent of one core since the last sample
+    unsigned long long startTime = 0; //clock ticks after boot, from /stat
+    unsigned long long cpuTicks = 0; //utime + stime at the last sample
+    std::chrono::steady_clock::time_point cpuSampled{};
 };
 
+//converts a state letter, unknown letters become UNKNOWN
+ProcessState parseState(const char state) {
+    switch (state) {
+        case 'R':
+        case 'S':
+        case 'D':
+        case 'T':
+        case 't':
+        case 'X':
+        case 'Z':
+        case 'P':
+        case 'I':
+            return static_cast<ProcessState>(state);
+        default:
+            return ProcessState::UNKNOWN;
+    }
+}
+
+//the /status style description of a state
+const char *stateDescription(const ProcessState state) {
+    switch (state) {
+        case ProcessState::RUNNING:
+            return "R (running)";
+        case ProcessState::SLEEPING:
+            return "S (sleeping)";
+        case ProcessState::DISK_SLEEP:
+            return "D (disk sleep)";
+        case ProcessState::STOPPED:
+            return "T (stopped)";
+        case ProcessState::TRACING_STOP:
+            return "t (tracing stop)";
+        case ProcessState::DEAD:
+            return "X (dead)";
+        case ProcessState::ZOMBIE:
+            return "Z (zombie)";
+        case ProcessState::PARKED:
+            return "P (parked)";
+        case ProcessState::IDLE:
+            return "I (idle)";
+        default:
+            return "? (unknown)";
+    }
+}
+
 enum class MemoryType {
     FREE, MAX
 };
 
+//which files the list view is collected from
+enum class CollectorMode {
+    STATUS, //the multi-line /status file, has every field
+    STAT //the single-line /stat and /statm files, no swap and file descriptors
+};
+
+//record format of the batch mode
+enum class OutputFormat {
+    JSON, //one object per line
+    CSV
+};
+
+//the fields of /stat the collector uses
+struct StatFields {
+    int pid = -1;
+    std::string_view name; //points into the read buffer of the thread
+    char state = '?';
+    int ppid = -1;
+    int threads = 1;
+    unsigned long long cpuTicks = 0; //utime + stime
+    unsigned long long startTime = 0;
+};
+
 struct Statistics {
     long usedRam;
     int numProcesses;
     long maxAvailableRam;
     long freeRam;
+    long totalRamKb = 0; //as read from /proc/meminfo, the MB values are rounded down from these
+    long availableRamKb = 0;
     int running = 0;
     int zombie = 0;
     int sleeping = 0;
     int stopped = 0;
     int other = 0;
     int idle = 0;
+    float cpuUsage = 0; //all cores, percent
     std::vector<std::string> users = {"ALL"};
 };
 
@@ -59,681 +184,4899 @@ std::string parseData(const std::string &line, const std::string &searchString)
 
 //gets the process path from the PID
 std::string getProcessPath(int pid) {
-    std::ostringstream oss;
-    oss << "/proc/" << pid << "/exe";
-    std::vector<char> buf(1024);
-    ssize_t len = readlink(oss.str().c_str(), buf.data(), buf.size() - 1);
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/exe", pid);
+    char buf[PATH_MAX];
+    ssize_t len = readlink(path, buf, sizeof(buf));
     if (len != -1) {
-        buf[len] = '\0';
-        return std::string(buf.data());
+        return std::string(buf, len);
     }
     return {};
 }
 
-//converts UID (from /status) to username
+//converts UID (from /status) to username, reentrant since the collector calls it from several threads
+//NSS and LDAP entries can be larger than the size the system suggests, the buffer grows until the entry fits
 std::string uidToUsername(int uid) {
-    passwd *pw = getpwuid(uid);
-    if (pw) {
+    thread_local std::vector<char> buf;
+    if (buf.empty()) {
+        const long suggested = sysconf(_SC_GETPW_R_SIZE_MAX);
+        buf.resize(suggested > 0 ? static_cast<size_t>(suggested) : 1024);
+    }
+    passwd pwd{};
+    passwd *pw = nullptr;
+    int result;
+    while ((result = getpwuid_r(uid, &pwd, buf.data(), buf.size(), &pw)) == ERANGE && buf.size() < 1024 * 1024) {
+        buf.resize(buf.size() * 2);
+    }
+    if (result == 0 && pw) {
         return pw->pw_name;
     }
     return {};
 }
 
-//gets the data for the process by file path by searching /status file
-Process getProcessData(const std::string &filePath) {
-    Process process;
-    std::string status = filePath + "/status";
-    std::string nameFlag = "Name:";
-    std::string pidFlag = "Pid:";
-    std::string ppidFlag = "PPid:";
-    std::string ramUsageFlag = "VmRSS:";
-    std::string swapUsageFlag = "VmSwap:";
-    std::string stateFlag = "State:";
-    std::string fileDescriptorCountFlag = "FDSize:";
-    std::string uidFlag = "Uid:";
-    std::string line;
+//the blocks of a string pool, shared with the snapshots whose views still point into them
+struct StringArena {
+    static constexpr size_t blockSize = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char *current = nullptr; //block the short strings are appended to
+    size_t blockUsed = blockSize;
+    size_t bytes = 0; //of every string stored
+    std::unordered_set<std::string_view> strings;
+};
 
-    std::ifstream file;
-    file.open(status);
-    if (!file) {
-        std::cout << "file can not be opened" << std::endl;
+//stores every distinct string once in big blocks, the returned views stay valid as long as the arena they were interned in
+struct StringPool {
+    std::mutex mutex;
+    std::shared_ptr<StringArena> arena = std::make_shared<StringArena>();
+    size_t compactedBytes = 0; //bytes the last compaction kept
+};
+
+//returns the pooled copy of the text, thread safe
+std::string_view internString(StringPool &pool, const std::string_view text) {
+    //a fresh pool has no block yet, an empty string must not point into it
+    if (text.empty()) {
         return {};
     }
-
-    while (std::getline(file, line)) {
-
-        if (line.substr(0, nameFlag.length()) == nameFlag) {
-            process.name = parseData(line, nameFlag);
-        }
-        else if (line.substr(0, pidFlag.length()) == pidFlag) {
-            process.pid = std::stoi(parseData(line, pidFlag));
-        }
-        else if (line.substr(0, ppidFlag.length()) == ppidFlag) {
-            process.ppid = std::stoi(parseData(line, ppidFlag));
-        }
-        else if (line.substr(0, ramUsageFlag.length()) == ramUsageFlag) {
-            process.ramUsage = std::stoi(parseData(line, ramUsageFlag));
-        }
-        else if (line.substr(0, swapUsageFlag.length()) == swapUsageFlag) {
-            process.swapUsage = std::stoi(parseData(line, swapUsageFlag));
-        }
-        else if (line.substr(0, stateFlag.length()) == stateFlag) {
-            process.state = parseData(line, stateFlag);
-        }
-        else if (line.substr(0, fileDescriptorCountFlag.length()) == fileDescriptorCountFlag) {
-            process.numFileDescriptors = std::stoi(parseData(line, fileDescriptorCountFlag));
-        }
-        else if (line.substr(0, uidFlag.length()) == uidFlag) {
-            process.uid = std::stoi(parseData(line, uidFlag));
-        }
+    std::lock_guard lock(pool.mutex);
+    StringArena &arena = *pool.arena;
+    const auto it = arena.strings.find(text);
+    if (it != arena.strings.end()) {
+        return *it;
     }
-    file.close();
-    if (process.pid != -1) {
-        process.processPath = getProcessPath(process.pid);
+    char *storage;
+    if (text.length() > StringArena::blockSize / 4) {
+        //long strings get their own block, the current one stays open
+        arena.blocks.push_back(std::make_unique<char[]>(text.length()));
+        storage = arena.blocks.back().get();
     }
-    if (process.uid != -1) {
-        process.userName = uidToUsername(process.uid);
+    else {
+        if (arena.blockUsed + text.length() > StringArena::blockSize) {
+            arena.blocks.push_back(std::make_unique<char[]>(StringArena::blockSize));
+            arena.current = arena.blocks.back().get();
+            arena.blockUsed = 0;
+        }
+        storage = arena.current + arena.blockUsed;
+        arena.blockUsed += text.length();
     }
-    return process;
+    arena.bytes += text.length();
+    std::memcpy(storage, text.data(), text.length());
+    return *arena.strings.insert(std::string_view(storage, text.length())).first;
 }
 
-//returns a vector of processes
-std::vector<Process> getProcesses() {
-    std::vector<Process> processes;
-    //iterate through directories in /proc folder
-    for (const auto &directory : fs::directory_iterator("/proc")) {
+//a pool is compacted once it holds this much and twice what the last compaction kept, so the work is spread over the growth
+constexpr size_t stringPoolCompactBytes = 1024 * 1024;
 
-        //get only directories that start with a number
-        if (fs::is_directory(directory) && directory.path().filename().string()[0] > '0' && directory.path().filename().string()[0] < '9') {
-            //std::cout << directory.path() << std::endl;
-            processes.push_back(getProcessData(directory.path().string()));
-        }
-    }
-    return processes;
+//true if the strings interned since the last compaction are worth rebuilding the pool for
+bool stringPoolNeedsCompaction(StringPool &pool) {
+    std::lock_guard lock(pool.mutex);
+    return pool.arena->bytes >= std::max(stringPoolCompactBytes, pool.compactedBytes * 2);
 }
 
-//debugging only, prints all processes
-void printProcess(const Process &process) {
-    printf("----------------\n[%d] Process name: %s \nState: %s\n", process.pid, process.name.c_str(), process.state.c_str());
-    printf("Parent PID: %d\n", process.ppid);
-    if (process.ramUsage < 1024) {
-        printf("RAM usage: %dkB\n", process.ramUsage);
+//moves the pool to a new arena, reintern gets a function that moves a view of the old arena to the new one
+//strings nobody reinterns are dropped, the old arena is freed with the last snapshot that holds it
+template<typename Reintern>
+void compactStringPool(StringPool &pool, const Reintern &reintern) {
+    std::shared_ptr<StringArena> old;
+    {
+        std::lock_guard lock(pool.mutex);
+        old = std::exchange(pool.arena, std::make_shared<StringArena>());
     }
-    else {
-        printf("RAM usage: %dMB\n", process.ramUsage/1024);
+    reintern([&pool](std::string_view &text) {
+        text = internString(pool, text);
+    });
+    std::lock_guard lock(pool.mutex);
+    pool.compactedBytes = pool.arena->bytes;
+}
+
+//the pool of the process names, names only change on exec so it grows with the distinct names
+StringPool &getNamePool() {
+    static StringPool pool;
+    return pool;
+}
+
+//sets the name of the process, the pool is only locked when the name changed
+void setProcessName(Process &process, const std::string_view name) {
+    if (name != process.name) {
+        process.name = internString(getNamePool(), name);
     }
+}
 
-    if (process.swapUsage < 1024) {
-        printf("Swap usage: %dkB\n", process.swapUsage);
+//a uid without a name is asked again after this long, directory backed users don't touch /etc/passwd
+constexpr std::chrono::seconds userRetryInterval(30);
+
+//uid to username cache, dropped when /etc/passwd changes
+struct UserCache {
+    struct Entry {
+        std::string_view name; //empty if the lookup failed
+        std::chrono::steady_clock::time_point retryAt; //when a failed lookup is tried again
+    };
+    std::shared_mutex mutex;
+    std::unordered_map<int, Entry> names;
+    StringPool pool; //never cleared, so names held by processes stay valid across reloads
+    timespec passwdModified{};
+};
+
+//the cache shared by every collector
+UserCache &getUserCache() {
+    static UserCache cache;
+    return cache;
+}
+
+//drops the cached names if /etc/passwd changed since the last call, returns true if it did
+bool validateUserCache(UserCache &cache) {
+    struct stat info{};
+    if (stat("/etc/passwd", &info) != 0) {
+        return false;
     }
-    else {
-        printf("Swap usage: %dMB\n", process.swapUsage / 1024);
+    std::unique_lock lock(cache.mutex);
+    if (info.st_mtim.tv_sec == cache.passwdModified.tv_sec && info.st_mtim.tv_nsec == cache.passwdModified.tv_nsec) {
+        return false;
     }
-    printf("File descriptors: %d\n", process.numFileDescriptors);
-    printf("----------------");
+    const bool changed = cache.passwdModified.tv_sec != 0 || cache.passwdModified.tv_nsec != 0;
+    cache.passwdModified = info.st_mtim;
+    cache.names.clear();
+    return changed;
 }
 
-//gets the memory by type
-long getMemory(MemoryType type) {
-    std::string referenceKey;
-    switch (type) {
-        case MemoryType::MAX:
-            referenceKey = "MemTotal:";
-        break;
-        case MemoryType::FREE:
-            referenceKey = "MemAvailable:";
-        break;
-    }
-    std::ifstream file("/proc/meminfo");
-    std::string key;
-    long value;
-    std::string kB;
-    while (file >> key >> value >> kB) {
-        if (key == referenceKey) {
-            return value;
+//gets the interned username of the uid, looked up on the first call for every uid and again only after a failed lookup expired
+std::string_view lookupUsername(UserCache &cache, const int uid) {
+    {
+        std::shared_lock lock(cache.mutex);
+        const auto it = cache.names.find(uid);
+        if (it != cache.names.end() && (!it->second.name.empty() || std::chrono::steady_clock::now() < it->second.retryAt)) {
+            return it->second.name;
         }
     }
-    return -1;
+    //failed lookups are cached for a while, so NSS isn't asked every refresh but a name that appears later is picked up
+    const std::string_view name = internString(cache.pool, uidToUsername(uid));
+    std::unique_lock lock(cache.mutex);
+    cache.names.insert_or_assign(uid, UserCache::Entry{name, std::chrono::steady_clock::now() + userRetryInterval});
+    return name;
 }
 
-//checks if the string is in the vector (helper for filterUnique)
-bool isInVector(const std::string &item, const std::vector<std::string> &data) {
-    for (const auto& it : data) {
-        if (it == item) {
-            return true;
+//exe path of a process, valid while the process keeps its start time and name
+struct ExePathEntry {
+    unsigned long long startTime = 0;
+    std::string_view name;
+    std::string_view path;
+};
+
+//pid to exe path cache, readlink only runs for new processes and after an exec changed the name
+struct ExePathCache {
+    std::shared_mutex mutex;
+    std::unordered_map<int, ExePathEntry> entries;
+    StringPool pool; //paths and names, shared by every process running the same binary
+    std::atomic<unsigned long> hits = 0;
+    std::atomic<unsigned long> misses = 0;
+};
+
+//the cache shared by every collector
+ExePathCache &getExePathCache() {
+    static ExePathCache cache;
+    return cache;
+}
+
+//the arenas the names and exe paths of a copied process table point into, a copy keeps them alive
+struct StringPoolHold {
+    std::shared_ptr<const StringArena> names;
+    std::shared_ptr<const StringArena> paths;
+    bool operator==(const StringPoolHold &) const = default;
+};
+
+StringPoolHold holdStringPools() {
+    StringPoolHold hold;
+    {
+        std::lock_guard lock(getNamePool().mutex);
+        hold.names = getNamePool().arena;
+    }
+    std::lock_guard lock(getExePathCache().pool.mutex);
+    hold.paths = getExePathCache().pool.arena;
+    return hold;
+}
+
+//gets the interned exe path of the process, reads the link only if the process is new or exec'd since the last call
+std::string_view lookupExePath(ExePathCache &cache, const int pid, const unsigned long long startTime, const std::string_view name) {
+    {
+        std::shared_lock lock(cache.mutex);
+        const auto it = cache.entries.find(pid);
+        if (it != cache.entries.end() && it->second.startTime == startTime && it->second.name == name) {
+            cache.hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second.path;
         }
     }
-    return false;
+    cache.misses.fetch_add(1, std::memory_order_relaxed);
+    const ExePathEntry entry{startTime, internString(cache.pool, name), internString(cache.pool, getProcessPath(pid))};
+    std::unique_lock lock(cache.mutex);
+    cache.entries[pid] = entry;
+    return entry.path;
 }
 
-//filters unique strings in a vector (for users)
-std::vector<std::string> filterUnique(std::vector<std::string> data) {
-    std::vector<std::string> filtered;
-    for (const auto& item : data) {
-        if (!isInVector(item, filtered)) {
-            filtered.push_back(item);
+//share of lookups answered from the cache in percent
+double exePathHitRate(const ExePathCache &cache) {
+    const unsigned long hits = cache.hits.load(std::memory_order_relaxed);
+    const unsigned long total = hits + cache.misses.load(std::memory_order_relaxed);
+    return total == 0 ? 0 : 100.0 * static_cast<double>(hits) / static_cast<double>(total);
+}
+
+//size of the per thread buffer the /proc files are read into, /status is about 1.5kB
+constexpr size_t procFileBufferSize = 8192;
+
+//reads a whole /proc file with one read() into the buffer of the calling thread, empty if it can't be read
+std::string_view readProcFile(const int pid, const char *fileName) {
+    thread_local char buffer[procFileBufferSize];
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/%s", pid, fileName);
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return {};
+    }
+    const ssize_t length = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    if (length <= 0) {
+        return {};
+    }
+    return {buffer, static_cast<size_t>(length)};
+}
+
+//returns the value after the key with leading whitespace skipped
+std::string_view statusValue(const std::string_view line, const std::string_view key) {
+    std::string_view value = line.substr(key.length());
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    return value;
+}
+
+//converts the leading number of the value, keeps the old value when there is none
+template <typename T>
+void parseNumber(const std::string_view value, T &number) {
+    std::from_chars(value.data(), value.data() + value.length(), number);
+}
+
+//parses the /status file into the process, with dynamicOnly set the fields fixed for the process lifetime are skipped
+//reads the file with a single read() and doesn't allocate unless the name or state outgrow their strings
+bool readStatusFile(const int pid, Process &process, const bool dynamicOnly) {
+    std::string_view data = readProcFile(pid, "status");
+    if (data.empty()) {
+        //the process exited between listing /proc and opening it
+        return false;
+    }
+    //kernel threads have no memory lines, don't keep the values of the last refresh
+    process.ramUsage = -1;
+    process.swapUsage = -1;
+
+    while (!data.empty()) {
+        const size_t lineEnd = data.find('\n');
+        const std::string_view line = data.substr(0, lineEnd);
+        data.remove_prefix(lineEnd == std::string_view::npos ? data.length() : lineEnd + 1);
+
+        if (line.starts_with("Name:")) {
+            //the name changes on exec, so it's read every time
+            setProcessName(process, statusValue(line, "Name:"));
+        }
+        else if (line.starts_with("Pid:")) {
+            if (!dynamicOnly) {
+                parseNumber(statusValue(line, "Pid:"), process.pid);
+            }
+        }
+        else if (line.starts_with("PPid:")) {
+            parseNumber(statusValue(line, "PPid:"), process.ppid);
+        }
+        else if (line.starts_with("VmRSS:")) {
+            parseNumber(statusValue(line, "VmRSS:"), process.ramUsage);
+        }
+        else if (line.starts_with("VmSwap:")) {
+            parseNumber(statusValue(line, "VmSwap:"), process.swapUsage);
+        }
+        else if (line.starts_with("State:")) {
+            const std::string_view state = statusValue(line, "State:");
+            process.state = state.empty() ? ProcessState::UNKNOWN : parseState(state[0]);
+        }
+        else if (line.starts_with("FDSize:")) {
+            parseNumber(statusValue(line, "FDSize:"), process.numFileDescriptors);
+        }
+        else if (line.starts_with("Uid:")) {
+            parseNumber(statusValue(line, "Uid:"), process.uid);
+        }
+        else if (line.starts_with("Threads:")) {
+            parseNumber(statusValue(line, "Threads:"), process.threads);
+            //the interesting lines are over, skip the signal masks and cpu lists at the end
+            break;
         }
     }
-    return filtered;
+    return true;
 }
 
-//gets the statistics of all processes
-Statistics getStatistics(const std::vector<Process> &processes) {
-    Statistics stats{};
-    int sum = 0;
-    for (const auto &process : processes) {
-        sum += process.ramUsage;
-        switch (process.state[0]) {
-            case 'S':
-                stats.sleeping++;
+//parses the contents of a /stat file
+bool parseStatFields(std::string_view data, StatFields &fields) {
+    //the name can contain spaces and parentheses, the fields start after the last ')'
+    const size_t nameStart = data.find('(');
+    const size_t nameEnd = data.rfind(')');
+    if (nameStart == std::string_view::npos || nameEnd == std::string_view::npos || nameEnd < nameStart || nameEnd + 2 >= data.length()) {
+        return false;
+    }
+    parseNumber(data.substr(0, nameStart), fields.pid);
+    fields.name = data.substr(nameStart + 1, nameEnd - nameStart - 1);
+    data.remove_prefix(nameEnd + 2);
+    //state is field 3, ppid 4, utime 14, stime 15, num_threads 20, starttime 22
+    unsigned long long utime = 0;
+    unsigned long long stime = 0;
+    for (int field = 3; !data.empty(); field++) {
+        const size_t space = data.find(' ');
+        const std::string_view value = data.substr(0, space);
+        switch (field) {
+            case 3:
+                fields.state = value[0];
             break;
-            case 'Z':
-                stats.zombie++;
+            case 4:
+                parseNumber(value, fields.ppid);
             break;
-            case 'R':
-                stats.running++;
+            case 14:
+                parseNumber(value, utime);
             break;
-            case 'T':
-                stats.stopped++;
+            case 15:
+                parseNumber(value, stime);
+                fields.cpuTicks = utime + stime;
             break;
-            case 'I':
-                stats.idle++;
+            case 20:
+                parseNumber(value, fields.threads);
             break;
+            case 22:
+                return std::from_chars(value.data(), value.data() + value.length(), fields.startTime).ec == std::errc();
             default:
-                stats.other++;
+                break;
+        }
+        if (space == std::string_view::npos) {
+            break;
         }
-        stats.users.push_back(process.userName);
+        data.remove_prefix(space + 1);
     }
-    stats.users = filterUnique(stats.users);
-    const long totalRam = getMemory(MemoryType::MAX);
-    const long availableRam = getMemory(MemoryType::FREE);
+    return false;
+}
 
-    stats.numProcesses = processes.size();
-    stats.maxAvailableRam = totalRam / 1024;
-    stats.freeRam = availableRam / 1024;
-    stats.usedRam = (totalRam - availableRam) / 1024;
-    return stats;
+//parses /stat, false if the process exited
+bool readStatFields(const int pid, StatFields &fields) {
+    return parseStatFields(readProcFile(pid, "stat"), fields);
 }
 
-//debugging only, prints to terminal
-void printStatistics(const Statistics &stats) {
-    printf("----------------\n");
-    printf("Number of processes: %d\n", stats.numProcesses);
-    printf("RAM usage: %ldMB/%ldMB (%ldMB free)\n", stats.usedRam, stats.maxAvailableRam, stats.freeRam);
-    printf("Running: %d, Sleeping: %d, Stopped: %d, Zombie: %d, Idle: %d, Other: %d\n",
-        stats.running, stats.sleeping, stats.stopped, stats.zombie, stats.idle, stats.other);
-    printf("----------------\n");
+//parses /task/<tid>/stat of a thread, false if the thread exited
+bool readTaskStatFields(const int pid, const int tid, StatFields &fields) {
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "task/%d/stat", tid);
+    return parseStatFields(readProcFile(pid, fileName), fields);
 }
 
-//debugging only, prints the data in the terminal
-void printInTerminal(const std::vector<Process> &processes, const Statistics &stats) {
-    printStatistics(stats);
-    for (const Process &process : processes) {
-        printProcess(process);
+
+//gets the uid of the process from the owner of its /proc directory (the effective uid, /status shows the real one)
+bool getProcessOwner(const int pid, int &uid) {
+    static const int procDirectory = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    char name[16];
+    snprintf(name, sizeof(name), "%d", pid);
+    struct stat info{};
+    if (fstatat(procDirectory, name, &info, 0) != 0) {
+        return false;
     }
+    uid = static_cast<int>(info.st_uid);
+    return true;
 }
 
-//filters the processes by status, helper function
-void getFilteredProcessesByStatus(const std::vector<Process> &processes, std::vector<Process> &filteredProcesses, const char status) {
-    for (const auto &proc : processes) {
-        if (proc.state[0] == status) {
-            filteredProcesses.push_back(proc);
-        }
+//fills the list view fields from the /stat fields, /statm and the directory owner
+bool applyStatFields(const StatFields &fields, Process &process, const bool dynamicOnly) {
+    //the name points into the read buffer, copy it before reading /statm
+    if (!dynamicOnly) {
+        process.pid = fields.pid;
     }
-}
+    setProcessName(process, fields.name);
+    process.ppid = fields.ppid;
+    process.threads = fields.threads;
+    process.state = parseState(fields.state);
 
-//filters processes by username, includes ALL
-std::vector<Process> filterProcessesUser(const std::vector<Process> &processes, const std::string &user) {
-    if (user == "ALL") {
-        return processes;
+    //resident pages are the 2nd field of /statm
+    static const long pageSizeKb = sysconf(_SC_PAGESIZE) / 1024;
+    std::string_view statm = readProcFile(fields.pid, "statm");
+    const size_t space = statm.find(' ');
+    if (space == std::string_view::npos) {
+        return false;
     }
-    std::vector<Process> filteredProcesses;
-    for (const auto &proc : processes) {
-        if (proc.userName == user) {
-            filteredProcesses.push_back(proc);
-        }
+    statm.remove_prefix(space + 1);
+    long residentPages = 0;
+    parseNumber(statm, residentPages);
+    process.ramUsage = static_cast<int>(residentPages * pageSizeKb);
+    //not in /stat, the detail screen reads it from /status
+    process.swapUsage = -1;
+
+    return getProcessOwner(process.pid, process.uid);
+}
+
+//fills the list view fields from /stat and /statm
+bool readStatFile(const int pid, Process &process, const bool dynamicOnly) {
+    StatFields fields;
+    if (!readStatFields(pid, fields)) {
+        return false;
     }
-    return filteredProcesses;
+    return applyStatFields(fields, process, dynamicOnly);
 }
 
-//filters processes by status
-std::vector<Process> filterProcessesStatus(const std::vector<Process> &processes, const std::string &currentMode) {
-    std::vector<Process> fp = {};
-    if (currentMode == "ALL") {
-        fp = processes;
+//gets the data for the process from /status or /stat depending on the collector mode
+Process getProcessData(const int pid, const unsigned long long startTime, const CollectorMode mode = CollectorMode::STATUS) {
+    Process process;
+    const bool found = mode == CollectorMode::STAT ? readStatFile(pid, process, false) : readStatusFile(pid, process, false);
+    if (!found) {
+        return {};
     }
-    else if (currentMode == "RUNNING") {
-        getFilteredProcessesByStatus(processes, fp, 'R');
+    process.startTime = startTime;
+    if (process.pid != -1) {
+        process.processPath = lookupExePath(getExePathCache(), process.pid, startTime, process.name);
     }
-    else if (currentMode == "ZOMBIE") {
-        getFilteredProcessesByStatus(processes, fp, 'Z');
+    if (process.uid != -1) {
+        process.userName = lookupUsername(getUserCache(), process.uid);
     }
-    else if (currentMode == "SLEEPING") {
-        getFilteredProcessesByStatus(processes, fp, 'S');
+    return process;
+}
+
+//takes a new cpu time sample, the usage is the cpu time used since the previous sample of the process or thread
+template <typename T>
+void sampleCpu(T &process, const unsigned long long cpuTicks) {
+    static const double ticksPerSecond = static_cast<double>(sysconf(_SC_CLK_TCK));
+    const auto now = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(now - process.cpuSampled).count();
+    if (process.cpuSampled != std::chrono::steady_clock::time_point{} && seconds > 0 && cpuTicks >= process.cpuTicks) {
+        process.cpuUsage = static_cast<float>(100.0 * static_cast<double>(cpuTicks - process.cpuTicks) / (seconds * ticksPerSecond));
     }
-    else if (currentMode == "STOPPED") {
-        getFilteredProcessesByStatus(processes, fp, 'T');
+    process.cpuTicks = cpuTicks;
+    process.cpuSampled = now;
+}
+
+//re-reads only the fields that change while the process runs, false if the process exited
+//the /stat mode reuses the fields already read for the start time check
+bool updateProcessData(Process &process, const CollectorMode mode, const StatFields &fields) {
+    const int oldUid = process.uid;
+    const bool found = mode == CollectorMode::STAT ? applyStatFields(fields, process, true) : readStatusFile(process.pid, process, true);
+    if (!found) {
+        return false;
     }
-    else if (currentMode == "IDLE") {
-        getFilteredProcessesByStatus(processes, fp, 'I');
+    if (process.uid != oldUid) {
+        process.userName = lookupUsername(getUserCache(), process.uid);
     }
-    return fp;
+    process.processPath = lookupExePath(getExePathCache(), process.pid, process.startTime, process.name);
+    sampleCpu(process, fields.cpuTicks);
+    return true;
 }
 
-//handles switching modes display on home screen
-void printModes(std::vector<std::string> modes, int currentModeIndex) {
-    init_pair(100, COLOR_RED, COLOR_BLACK);
-    const chtype modeColor = COLOR_PAIR(100);
-    for (int i = 0; i < modes.size(); i++) {
-        if (i == currentModeIndex) {
-            attron(A_BOLD);
-            attron(modeColor);
-        }
-        printw("%s", modes[i].c_str());
-        if (i == currentModeIndex) {
-            attroff(A_BOLD);
-            attroff(modeColor);
-        }
-        if (i != modes.size() - 1) {
-            printw("/");
+//command line options
+struct Options {
+    int workers = 0; //collector threads, 0 means one per core
+    CollectorMode collector = CollectorMode::STATUS;
+    bool events = false; //track processes with the kernel proc connector
+    std::string filter; //filter expression the home screen starts with
+    double interval = 5; //seconds between full scans when they are cheap enough
+    double cpuBudget = 5; //percent of one core the scans may take, the interval grows past it
+    int batch = 0; //samples written to stdout instead of running the ui
+    OutputFormat format = OutputFormat::JSON;
+    std::string record; //file the snapshots are recorded to instead of running the ui
+    int recordSize = 64; //MB the recording may take, the oldest snapshots are overwritten past it
+    std::string replay; //recording the ui browses instead of /proc
+    std::string serve; //[HOST:]PORT or unix socket path the metrics are served on instead of running the ui
+};
+
+//one slice of the work list, workers claim indexes from the front of it
+struct CollectorShard {
+    std::atomic<size_t> next = 0;
+    size_t end = 0;
+};
+
+//resolves the worker count, 0 means one per core
+int resolveWorkerCount(const int workers) {
+    if (workers > 0) {
+        return workers;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+//cpu time of the calling thread since it started
+double threadCpuSeconds() {
+    timespec time{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) / 1e9;
+}
+
+//runs job(index) for every index in [0, count) on workerCount threads
+//every worker drains its own shard first, then steals from the other shards so a few slow PIDs don't stall one thread
+//returns the cpu seconds of the threads it started, the share of the calling thread is the caller's to measure
+template <typename Job>
+double runSharded(const size_t count, int workerCount, const Job &job) {
+    const size_t claimSize = 4;
+    workerCount = static_cast<int>(std::min<size_t>(std::max(workerCount, 1), std::max<size_t>(count / claimSize, 1)));
+    if (workerCount == 1) {
+        for (size_t i = 0; i < count; i++) {
+            job(i);
+        }
+        return 0;
+    }
+
+    std::vector<CollectorShard> shards(workerCount);
+    for (int i = 0; i < workerCount; i++) {
+        shards[i].next = count * i / workerCount;
+        shards[i].end = count * (i + 1) / workerCount;
+    }
+
+    auto work = [&](const int self) {
+        for (int k = 0; k < workerCount; k++) {
+            CollectorShard &shard = shards[(self + k) % workerCount];
+            while (true) {
+                const size_t begin = shard.next.fetch_add(claimSize);
+                if (begin >= shard.end) {
+                    break;
+                }
+                const size_t end = std::min(begin + claimSize, shard.end);
+                for (size_t i = begin; i < end; i++) {
+                    job(i);
+                }
+            }
         }
+    };
+
+    std::atomic<double> workerCpuSeconds = 0;
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workerCount; i++) {
+        threads.emplace_back([&, i] {
+            work(i);
+            workerCpuSeconds.fetch_add(threadCpuSeconds(), std::memory_order_relaxed);
+        });
     }
+    work(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return workerCpuSeconds.load(std::memory_order_relaxed);
 }
 
-//TODO maybe use templates, floats go crazy, ram should have decimals
-//helper for printing single file data lines, for color handling
-void printLine(int y, int x, const std::string &text1, const chtype color1, const std::string &text2, const chtype color2, int &i) {
-    attron(color1);
-    attron(A_BOLD);
-    mvprintw(y, x, "%s", text1.c_str());
-    attroff(color1);
-    attron(color2);
-    printw("%s", text2.c_str());
-    attroff(A_BOLD);
-    attroff(color2);
-    i++;
+//a directory entry as returned by getdents64
+struct LinuxDirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+//lists the entries of a /proc directory named by a number with raw getdents64, the vector is cleared first
+void enumerateNumericEntries(const char *path, std::vector<int> &pids) {
+    thread_local char buffer[64 * 1024];
+    pids.clear();
+    const int procDirectory = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (procDirectory == -1) {
+        return;
+    }
+    long length;
+    while ((length = syscall(SYS_getdents64, procDirectory, buffer, sizeof(buffer))) > 0) {
+        for (long offset = 0; offset < length;) {
+            const auto *entry = reinterpret_cast<const LinuxDirent64 *>(buffer + offset);
+            offset += entry->d_reclen;
+            if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) {
+                continue;
+            }
+            //only directories named by digits are processes
+            int pid = 0;
+            const char *c = entry->d_name;
+            for (; *c >= '0' && *c <= '9'; c++) {
+                pid = pid * 10 + (*c - '0');
+            }
+            if (*c == '\0' && pid > 0) {
+                pids.push_back(pid);
+            }
+        }
+    }
+    close(procDirectory);
 }
 
-//prints the top quit instructions on single file display
-void printQuitInstructions(const int y, const int x) {
-    const chtype red = COLOR_PAIR(2);
-    const chtype green = COLOR_PAIR(4);
-    mvprintw(y, x, "Press ");
-    attron(red);
-    attron(A_BOLD);
-    printw("[K]");
-    attroff(A_BOLD);
-    attron(green);
-    printw(" to kill the process, press ");
-    attron(red);
-    attron(A_BOLD);
-    printw("[Q]");
-    attroff(A_BOLD);
-    attron(green);
-    printw(" to quit this page");
-    attron(red);
+//lists the PIDs in /proc, the vector is reused between refreshes
+void enumeratePids(std::vector<int> &pids) {
+    enumerateNumericEntries("/proc", pids);
 }
 
-//kill confirm screen for single file data display
-bool killConfirmation(const int pid) {
-    init_pair(22, COLOR_WHITE, COLOR_RED);
-    clear();
-    bkgd(COLOR_PAIR(22));
-    attron(A_BOLD);
-    std::string text1 = "Press [K] to kill this process";
-    std::string text2 = "Press [T] to terminate this process";
-    std::string text3 = "Press any other key to quit";
-    mvprintw(LINES/2, COLS/2 - text1.length()/2, "%s", text1.c_str());
-    mvprintw(LINES/2 + 1, COLS/2 - text2.length()/2, "%s", text2.c_str());
-    mvprintw(LINES/2 + 2, COLS/2 - text3.length()/2, "%s", text3.c_str());
-    attroff(A_BOLD);
-    const char ch = getch();
-    if (ch == 'k') {
-        return kill(pid, SIGKILL) == 0;
+//returns a vector of processes, the PIDs are sharded across workerCount threads
+std::vector<Process> getProcesses(const int workerCount, const CollectorMode mode = CollectorMode::STATUS) {
+    validateUserCache(getUserCache());
+    std::vector<int> pids;
+    enumeratePids(pids);
+    std::vector<Process> processes(pids.size());
+    runSharded(pids.size(), workerCount, [&](const size_t i) {
+        StatFields fields;
+        if (readStatFields(pids[i], fields)) {
+            processes[i] = getProcessData(pids[i], fields.startTime, mode);
+            sampleCpu(processes[i], fields.cpuTicks);
+        }
+    });
+    //drop the processes that exited during the scan
+    std::erase_if(processes, [](const Process &process) {
+        return process.pid == -1;
+    });
+    return processes;
+}
+
+//a thread of the process shown on the detail screen
+struct ThreadInfo {
+    int tid = -1;
+    std::string name;
+    char state = '?';
+    float cpuUsage = 0; //percent of one core since the last sample
+    unsigned long long cpuTicks = 0;
+    std::chrono::steady_clock::time_point cpuSampled{};
+};
 
+//rescans /proc/<pid>/task, the threads keep their cpu samples between calls
+//processes with thousands of threads are scanned on workerCount threads
+void refreshThreads(const int pid, std::vector<ThreadInfo> &threads, const int workerCount) {
+    std::vector<int> tids;
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+    enumerateNumericEntries(path, tids);
+
+    std::unordered_map<int, size_t> previous;
+    for (size_t i = 0; i < threads.size(); i++) {
+        previous[threads[i].tid] = i;
     }
-    if (ch == 't') {
-        return kill(pid, SIGTERM) == 0;
+    std::vector<ThreadInfo> current(tids.size());
+    const int parallelThreshold = 256;
+    runSharded(tids.size(), tids.size() >= parallelThreshold ? workerCount : 1, [&](const size_t i) {
+        StatFields fields;
+        if (!readTaskStatFields(pid, tids[i], fields)) {
+            return;
+        }
+        ThreadInfo &thread = current[i];
+        const auto it = previous.find(tids[i]);
+        if (it != previous.end()) {
+            thread = threads[it->second];
+        }
+        thread.tid = tids[i];
+        thread.name.assign(fields.name);
+        thread.state = fields.state;
+        sampleCpu(thread, fields.cpuTicks);
+    });
+    std::erase_if(current, [](const ThreadInfo &thread) {
+        return thread.tid == -1;
+    });
+    threads = std::move(current);
+}
+
+//sorts the threads, hottest first or by thread id
+void sortThreads(std::vector<ThreadInfo> &threads, const bool byCpu) {
+    std::sort(threads.begin(), threads.end(), [byCpu](const ThreadInfo &thread1, const ThreadInfo &thread2) {
+        if (byCpu && thread1.cpuUsage != thread2.cpuUsage) {
+            return thread1.cpuUsage > thread2.cpuUsage;
+        }
+        return thread1.tid < thread2.tid;
+    });
+}
+
+//processes kept between refreshes, identified by pid and start time so PID reuse is detected
+struct ProcessTable {
+    std::vector<Process> processes;
+    std::unordered_map<int, size_t> indexByPid;
+    std::vector<unsigned> lastSeen; //refresh in which processes[i] was last found
+    unsigned generation = 0;
+    //scratch space of the refresh, kept to reuse the allocations
+    std::vector<int> pids;
+    std::vector<unsigned long long> startTimes;
+    std::vector<unsigned long long> cpuTicks;
+    std::vector<size_t> newIndexes;
+    //jiffies of all cores from /proc/stat at the last refresh
+    unsigned long long totalJiffies = 0;
+    unsigned long long idleJiffies = 0;
+    float cpuUsage = 0; //all cores, percent
+    double workerCpuSeconds = 0; //cpu time of the worker threads of the last refresh
+};
+
+//removes processes[index] by moving the last entry into its place
+void removeTableEntry(ProcessTable &table, const size_t index) {
+    table.indexByPid.erase(table.processes[index].pid);
+    if (index != table.processes.size() - 1) {
+        table.processes[index] = std::move(table.processes.back());
+        table.lastSeen[index] = table.lastSeen.back();
+        table.indexByPid[table.processes[index].pid] = index;
     }
-    return false;
+    table.processes.pop_back();
+    table.lastSeen.pop_back();
 }
 
-//prints the border on the screen, offset moves it inside by x
-void printBorder(const chtype color, const int offset = 0) {
-    attron(color);
-    mvhline(0 + offset, 0 + offset, ACS_HLINE, COLS - offset * 2);
-    mvhline(LINES - 1 - offset, 0 + offset, ACS_HLINE, COLS - offset * 2);
-    mvvline(0 + offset, 0 + offset, ACS_VLINE, LINES - offset * 2);
-    mvvline(0 + offset, COLS - 1 - offset, ACS_VLINE, LINES - offset * 2);
+//appends a process that isn't in the table yet
+void addTableEntry(ProcessTable &table, Process &&process) {
+    table.indexByPid[process.pid] = table.processes.size();
+    table.processes.push_back(std::move(process));
+    table.lastSeen.push_back(table.generation);
+}
 
-    mvaddch(0 + offset, 0 + offset, ACS_ULCORNER);
-    mvaddch(0 + offset, COLS - 1 - offset, ACS_URCORNER);
-    mvaddch(LINES - 1 - offset, 0 + offset, ACS_LLCORNER);
-    mvaddch(LINES - 1 - offset, COLS - 1 - offset, ACS_LRCORNER);
-    attroff(color);
+//drops the cached exe paths of the processes that left the table
+void pruneExePathCache(ExePathCache &cache, const ProcessTable &table) {
+    std::unique_lock lock(cache.mutex);
+    std::erase_if(cache.entries, [&](const auto &entry) {
+        const auto it = table.indexByPid.find(entry.first);
+        return it == table.indexByPid.end() || table.processes[it->second].startTime != entry.second.startTime;
+    });
 }
 
-//only handles the printing of data of a single file
-void printSingleProcessData(const Process& process, int line, int xOffset) {
-    const chtype black = COLOR_PAIR(1);
-    const chtype red = COLOR_PAIR(2);
-    const chtype blue = COLOR_PAIR(3);
-    const chtype green = COLOR_PAIR(4);
-    clear();
-    bkgd(green);
+//names and paths of exited processes are never looked up again, once they fill most of a pool it is rebuilt from the table
+//the collector calls this between scans, when nothing else interns into the pools or reads the exe path cache
+void compactStringPools(ProcessTable &table) {
+    StringPool &names = getNamePool();
+    if (stringPoolNeedsCompaction(names)) {
+        compactStringPool(names, [&](const auto &reintern) {
+            for (Process &process : table.processes) {
+                reintern(process.name);
+            }
+        });
+    }
+    ExePathCache &cache = getExePathCache();
+    if (stringPoolNeedsCompaction(cache.pool)) {
+        std::unique_lock lock(cache.mutex);
+        compactStringPool(cache.pool, [&](const auto &reintern) {
+            for (auto &[pid, entry] : cache.entries) {
+                reintern(entry.name);
+                reintern(entry.path);
+            }
+            for (Process &process : table.processes) {
+                reintern(process.processPath);
+            }
+        });
+    }
+}
 
-    const int currentRamUsage = process.ramUsage > 1024 ? static_cast<float>(process.ramUsage) / 1024 : static_cast<float>(process.ramUsage);
-    const std::string postfixRam = process.ramUsage > 1024 ? " MB" : " kB";
-    const int currentSwapUsage = process.swapUsage > 1024 ? static_cast<float>(process.swapUsage) / 1024 : static_cast<float>(process.swapUsage);
-    const std::string postfixSwap = process.swapUsage > 1024 ? " MB" : " kB";
+//updates the usage of all cores from the jiffies in the first line of /proc/stat
+void sampleSystemCpu(ProcessTable &table) {
+    std::ifstream file("/proc/stat");
+    std::string cpu;
+    unsigned long long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0;
+    if (!(file >> cpu >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal)) {
+        return;
+    }
+    const unsigned long long total = user + nice + system + idle + iowait + irq + softirq + steal;
+    const unsigned long long idleTotal = idle + iowait;
+    if (table.totalJiffies != 0 && total > table.totalJiffies) {
+        //iowait can go backwards (see proc(5)), the idle time may shrink between two samples
+        const double elapsed = static_cast<double>(total - table.totalJiffies);
+        const double busy = elapsed - (static_cast<double>(idleTotal) - static_cast<double>(table.idleJiffies));
+        table.cpuUsage = static_cast<float>(std::clamp(100.0 * busy / elapsed, 0.0, 100.0));
+    }
+    table.totalJiffies = total;
+    table.idleJiffies = idleTotal;
+}
 
-    printQuitInstructions(line, xOffset);
-    line++;
-    printLine(line, xOffset, "Name: ", black, process.name, red, line);
-    printLine(line, xOffset, "PID: ", black, std::to_string(process.pid), red, line);
-    printLine(line, xOffset, "State: ", black, process.state, red, line);
-    printLine(line, xOffset, "RAM usage: ", black, std::to_string(currentRamUsage) + postfixRam, red, line);
-    printLine(line, xOffset, "Process path: ", black, process.processPath, green, line);
-    printLine(line, xOffset, "PPID: ", black, std::to_string(process.ppid), blue, line);
-    printLine(line, xOffset, "Threads: ", black, std::to_string(process.threads), blue, line);
-    printLine(line, xOffset, "Swap usage: ", black, std::to_string(currentSwapUsage) + postfixSwap, blue, line);
-    printLine(line, xOffset, "Number of open file descriptors: ", black, std::to_string(process.numFileDescriptors), blue, line);
-    printLine(line, xOffset, "UID: ", black, std::to_string(process.uid), blue, line);
-    printLine(line, xOffset, "User: ", black, process.userName, red, line);
+//rescans /proc into the table, survivors only re-read their dynamic fields and new PIDs get the full parse
+void refreshProcessTable(ProcessTable &table, const int workerCount, const CollectorMode mode) {
+    const bool usersChanged = validateUserCache(getUserCache());
+    std::vector<int> &pids = table.pids;
+    enumeratePids(pids);
+    const unsigned generation = ++table.generation;
+    //a start time of ~0 marks the survivors and the PIDs that exited
+    const unsigned long long notNew = ~0ULL;
+    table.startTimes.assign(pids.size(), notNew);
+    table.cpuTicks.resize(pids.size());
+
+    //survivors are updated in place, every worker touches different entries
+    table.workerCpuSeconds = runSharded(pids.size(), workerCount, [&](const size_t i) {
+        StatFields fields;
+        if (!readStatFields(pids[i], fields)) {
+            return;
+        }
+        const auto it = table.indexByPid.find(fields.pid);
+        if (it != table.indexByPid.end() && table.processes[it->second].startTime == fields.startTime) {
+            if (updateProcessData(table.processes[it->second], mode, fields)) {
+                table.lastSeen[it->second] = generation;
+            }
+            return;
+        }
+        table.startTimes[i] = fields.startTime;
+        table.cpuTicks[i] = fields.cpuTicks;
+    });
+
+    std::vector<size_t> &newIndexes = table.newIndexes;
+    newIndexes.clear();
+    for (size_t i = 0; i < pids.size(); i++) {
+        if (table.startTimes[i] != notNew) {
+            newIndexes.push_back(i);
+        }
+    }
+    std::vector<Process> newProcesses(newIndexes.size());
+    table.workerCpuSeconds += runSharded(newIndexes.size(), workerCount, [&](const size_t i) {
+        newProcesses[i] = getProcessData(pids[newIndexes[i]], table.startTimes[newIndexes[i]], mode);
+        //the first sample only sets the baseline, the usage shows from the next refresh
+        sampleCpu(newProcesses[i], table.cpuTicks[newIndexes[i]]);
+    });
+
+    //remove exited processes and reused PIDs before inserting the new ones
+    for (size_t i = table.processes.size(); i-- > 0;) {
+        if (table.lastSeen[i] != generation) {
+            removeTableEntry(table, i);
+        }
+    }
+    for (auto &process : newProcesses) {
+        if (process.pid != -1) {
+            addTableEntry(table, std::move(process));
+        }
+    }
 
+    //survivors only look their user up when the uid changes, so renames need a pass over everything
+    if (usersChanged) {
+        for (auto &process : table.processes) {
+            process.userName = lookupUsername(getUserCache(), process.uid);
+        }
+    }
+    pruneExePathCache(getExePathCache(), table);
+    compactStringPools(table);
+    sampleSystemCpu(table);
 }
 
-//makes the single process data screen, uses a shit ton of helpers
-void displaySingleProcessData(const Process &process) {
-    int line = 3;//starting line
-    int xOffset = 4;
-    const chtype red = COLOR_PAIR(2);
+//a fork, exec or exit reported by the kernel
+struct ProcEvent {
+    enum class Type {
+        FORK, EXEC, EXIT
+    };
+    Type type;
+    int pid;
+};
 
-    const chtype borderColor = COLOR_PAIR(7);
-    bool looping = true;
-    while (looping) {
-        printSingleProcessData(process, line, xOffset );
-        printBorder(borderColor);
-        printBorder(borderColor, 1);
-        char ch = getch();
-        switch (ch) {
-            case 'q':
-                looping = false;
-            break;
-            case 'k':
-                looping = !killConfirmation(process.pid);
+//subscription to the kernel proc connector, fd is -1 when it isn't available
+struct ProcEventTracker {
+    int fd = -1;
+    std::vector<ProcEvent> pending;
+    bool lost = false; //the socket overflowed, only a full rescan is correct again
+    //counted since the last call of resetProcEventCounters, includes processes too short-lived to be scanned
+    unsigned long forks = 0;
+    unsigned long execs = 0;
+    unsigned long exits = 0;
+};
+
+//subscribes to fork/exec/exit events, needs CAP_NET_ADMIN, false if the kernel refused
+bool openProcEventTracker(ProcEventTracker &tracker) {
+    const int fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (fd == -1) {
+        return false;
+    }
+    sockaddr_nl address{};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = CN_IDX_PROC;
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return false;
+    }
+
+    alignas(nlmsghdr) char buffer[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))]{};
+    auto *header = reinterpret_cast<nlmsghdr *>(buffer);
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = getpid();
+    auto *message = static_cast<cn_msg *>(NLMSG_DATA(header));
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(proc_cn_mcast_op);
+    const proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+    std::memcpy(message->data, &op, sizeof(op));
+    if (send(fd, buffer, header->nlmsg_len, 0) == -1) {
+        close(fd);
+        return false;
+    }
+    tracker.fd = fd;
+    return true;
+}
+
+//reads every queued event without blocking, threads are skipped
+void drainProcEvents(ProcEventTracker &tracker) {
+    alignas(nlmsghdr) char buffer[8192];
+    while (true) {
+        const ssize_t length = recv(tracker.fd, buffer, sizeof(buffer), 0);
+        if (length == -1) {
+            if (errno == ENOBUFS) {
+                tracker.lost = true;
+                continue;
+            }
+            return;
+        }
+        int remaining = static_cast<int>(length);
+        for (auto *header = reinterpret_cast<nlmsghdr *>(buffer); NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+            const auto *message = static_cast<const cn_msg *>(NLMSG_DATA(header));
+            if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) {
+                continue;
+            }
+            proc_event event;
+            //the enum is nested in proc_event before Linux 6.6 and proc_cn_event after, the type of what names both
+            using ProcEventWhat = decltype(proc_event::what);
+            std::memcpy(&event, message->data, std::min<size_t>(message->len, sizeof(event)));
+            switch (event.what) {
+                case ProcEventWhat::PROC_EVENT_FORK:
+                    if (event.event_data.fork.child_pid == event.event_data.fork.child_tgid) {
+                        tracker.pending.push_back({ProcEvent::Type::FORK, event.event_data.fork.child_pid});
+                        tracker.forks++;
+                    }
                 break;
-            default:
+                case ProcEventWhat::PROC_EVENT_EXEC:
+                    if (event.event_data.exec.process_pid == event.event_data.exec.process_tgid) {
+                        tracker.pending.push_back({ProcEvent::Type::EXEC, event.event_data.exec.process_pid});
+                        tracker.execs++;
+                    }
                 break;
+                case ProcEventWhat::PROC_EVENT_EXIT:
+                    if (event.event_data.exit.process_pid == event.event_data.exit.process_tgid) {
+                        tracker.pending.push_back({ProcEvent::Type::EXIT, event.event_data.exit.process_pid});
+                        tracker.exits++;
+                    }
+                break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+//applies the queued events to the table in order, returns false if events were lost and a full rescan is needed
+bool applyProcEvents(ProcessTable &table, ProcEventTracker &tracker, const CollectorMode mode) {
+    drainProcEvents(tracker);
+    if (tracker.lost) {
+        tracker.pending.clear();
+        tracker.lost = false;
+        return false;
+    }
+    for (const ProcEvent &event : tracker.pending) {
+        const auto it = table.indexByPid.find(event.pid);
+        if (event.type == ProcEvent::Type::EXIT) {
+            if (it != table.indexByPid.end()) {
+                removeTableEntry(table, it->second);
+            }
+            continue;
+        }
+        //fork adds the child, exec re-reads the name and path, both may already be gone
+        StatFields fields;
+        if (!readStatFields(event.pid, fields)) {
+            continue;
+        }
+        if (it != table.indexByPid.end()) {
+            Process &process = table.processes[it->second];
+            if (process.startTime == fields.startTime && updateProcessData(process, mode, fields)) {
+                continue;
+            }
+            removeTableEntry(table, it->second);
+        }
+        Process process = getProcessData(event.pid, fields.startTime, mode);
+        sampleCpu(process, fields.cpuTicks);
+        if (process.pid != -1) {
+            addTableEntry(table, std::move(process));
+        }
+    }
+    tracker.pending.clear();
+    return true;
+}
+
+//drops the queued events before a full rescan and starts counting the next interval
+void resetProcEvents(ProcEventTracker &tracker) {
+    drainProcEvents(tracker);
+    tracker.pending.clear();
+    tracker.lost = false;
+    tracker.forks = 0;
+    tracker.execs = 0;
+    tracker.exits = 0;
+}
+
+//debugging only, prints all processes
+void printProcess(const Process &process) {
+    printf("----------------\n[%d] Process name: %.*s \nState: %s\n", process.pid, static_cast<int>(process.name.length()), process.name.data(), stateDescription(process.state));
+    printf("Parent PID: %d\n", process.ppid);
+    if (process.ramUsage < 1024) {
+        printf("RAM usage: %dkB\n", process.ramUsage);
+    }
+    else {
+        printf("RAM usage: %dMB\n", process.ramUsage/1024);
+    }
+
+    if (process.swapUsage < 1024) {
+        printf("Swap usage: %dkB\n", process.swapUsage);
+    }
+    else {
+        printf("Swap usage: %dMB\n", process.swapUsage / 1024);
+    }
+    printf("File descriptors: %d\n", process.numFileDescriptors);
+    printf("----------------");
+}
+
+//gets the memory by type
+long getMemory(MemoryType type) {
+    std::string referenceKey;
+    switch (type) {
+        case MemoryType::MAX:
+            referenceKey = "MemTotal:";
+        break;
+        case MemoryType::FREE:
+            referenceKey = "MemAvailable:";
+        break;
+    }
+    std::ifstream file("/proc/meminfo");
+    std::string key;
+    long value;
+    std::string kB;
+    while (file >> key >> value >> kB) {
+        if (key == referenceKey) {
+            return value;
+        }
+    }
+    return -1;
+}
+
+//checks if the string is in the vector (helper for filterUnique)
+bool isInVector(const std::string &item, const std::vector<std::string> &data) {
+    for (const auto& it : data) {
+        if (it == item) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//filters unique strings in a vector (for users)
+std::vector<std::string> filterUnique(std::vector<std::string> data) {
+    std::vector<std::string> filtered;
+    for (const auto& item : data) {
+        if (!isInVector(item, filtered)) {
+            filtered.push_back(item);
+        }
+    }
+    return filtered;
+}
+
+//gets the statistics of all processes
+Statistics getStatistics(const std::vector<Process> &processes, const float cpuUsage = 0) {
+    Statistics stats{};
+    stats.cpuUsage = cpuUsage;
+    int sum = 0;
+    for (const auto &process : processes) {
+        sum += process.ramUsage;
+        switch (process.state) {
+            case ProcessState::SLEEPING:
+                stats.sleeping++;
+            break;
+            case ProcessState::ZOMBIE:
+                stats.zombie++;
+            break;
+            case ProcessState::RUNNING:
+                stats.running++;
+            break;
+            case ProcessState::STOPPED:
+                stats.stopped++;
+            break;
+            case ProcessState::IDLE:
+                stats.idle++;
+            break;
+            default:
+                stats.other++;
+        }
+        stats.users.emplace_back(process.userName);
+    }
+    stats.users = filterUnique(stats.users);
+    const long totalRam = getMemory(MemoryType::MAX);
+    const long availableRam = getMemory(MemoryType::FREE);
+
+    stats.numProcesses = processes.size();
+    stats.maxAvailableRam = totalRam / 1024;
+    stats.freeRam = availableRam / 1024;
+    stats.usedRam = (totalRam - availableRam) / 1024;
+    stats.totalRamKb = totalRam;
+    stats.availableRamKb = availableRam;
+    return stats;
+}
+
+//debugging only, prints to terminal
+void printStatistics(const Statistics &stats) {
+    printf("----------------\n");
+    printf("Number of processes: %d\n", stats.numProcesses);
+    printf("RAM usage: %ldMB/%ldMB (%ldMB free)\n", stats.usedRam, stats.maxAvailableRam, stats.freeRam);
+    printf("Running: %d, Sleeping: %d, Stopped: %d, Zombie: %d, Idle: %d, Other: %d\n",
+        stats.running, stats.sleeping, stats.stopped, stats.zombie, stats.idle, stats.other);
+    printf("----------------\n");
+}
+
+//debugging only, prints the data in the terminal
+void printInTerminal(const std::vector<Process> &processes, const Statistics &stats) {
+    printStatistics(stats);
+    for (const Process &process : processes) {
+        printProcess(process);
+    }
+}
+
+//filters the processes by status, helper function
+void getFilteredProcessesByStatus(const std::vector<Process> &processes, std::vector<Process> &filteredProcesses, const char status) {
+    for (const auto &proc : processes) {
+        if (static_cast<char>(proc.state) == status) {
+            filteredProcesses.push_back(proc);
+        }
+    }
+}
+
+//filters processes by username, includes ALL, the home screen filters the columns, this is the reference for the benchmark
+std::vector<Process> filterProcessesUser(const std::vector<Process> &processes, const std::string &user) {
+    if (user == "ALL") {
+        return processes;
+    }
+    std::vector<Process> filteredProcesses;
+    for (const auto &proc : processes) {
+        if (proc.userName == user) {
+            filteredProcesses.push_back(proc);
+        }
+    }
+    return filteredProcesses;
+}
+
+//filters processes by status, the home screen filters the columns, this is the reference for the benchmark
+std::vector<Process> filterProcessesStatus(const std::vector<Process> &processes, const std::string &currentMode) {
+    std::vector<Process> fp = {};
+    if (currentMode == "ALL") {
+        fp = processes;
+    }
+    else if (currentMode == "RUNNING") {
+        getFilteredProcessesByStatus(processes, fp, 'R');
+    }
+    else if (currentMode == "ZOMBIE") {
+        getFilteredProcessesByStatus(processes, fp, 'Z');
+    }
+    else if (currentMode == "SLEEPING") {
+        getFilteredProcessesByStatus(processes, fp, 'S');
+    }
+    else if (currentMode == "STOPPED") {
+        getFilteredProcessesByStatus(processes, fp, 'T');
+    }
+    else if (currentMode == "IDLE") {
+        getFilteredProcessesByStatus(processes, fp, 'I');
+    }
+    return fp;
+}
+
+//printw that stops before the last column, so a header line never wraps onto the line below it
+[[gnu::format(printf, 1, 2)]] void printClipped(const char *format, ...) {
+    char text[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    for (const char *part = text;; ) {
+        const char *end = std::strchr(part, '\n');
+        const int length = end ? static_cast<int>(end - part) : static_cast<int>(std::strlen(part));
+        addnstr(part, std::min(length, std::max(0, COLS - 1 - getcurx(stdscr))));
+        if (!end) {
+            break;
+        }
+        addch('\n');
+        part = end + 1;
+    }
+}
+
+//handles switching modes display on home screen
+void printModes(std::vector<std::string> modes, int currentModeIndex) {
+    init_pair(100, COLOR_RED, COLOR_BLACK);
+    const chtype modeColor = COLOR_PAIR(100);
+    for (int i = 0; i < modes.size(); i++) {
+        if (i == currentModeIndex) {
+            attron(A_BOLD);
+            attron(modeColor);
+        }
+        printClipped("%s", modes[i].c_str());
+        if (i == currentModeIndex) {
+            attroff(A_BOLD);
+            attroff(modeColor);
+        }
+        if (i != modes.size() - 1) {
+            printClipped("/");
+        }
+    }
+}
+
+//TODO maybe use templates, floats go crazy, ram should have decimals
+//helper for printing single file data lines, for color handling
+void printLine(int y, int x, const std::string &text1, const chtype color1, const std::string &text2, const chtype color2, int &i) {
+    attron(color1);
+    attron(A_BOLD);
+    mvprintw(y, x, "%s", text1.c_str());
+    attroff(color1);
+    attron(color2);
+    printw("%s", text2.c_str());
+    attroff(A_BOLD);
+    attroff(color2);
+    i++;
+}
+
+//prints the top quit instructions on single file display, a recorded process can't be killed
+void printQuitInstructions(const int y, const int x, const bool recorded) {
+    const chtype red = COLOR_PAIR(2);
+    const chtype green = COLOR_PAIR(4);
+    mvprintw(y, x, "Press ");
+    if (!recorded) {
+        attron(red);
+        attron(A_BOLD);
+        printw("[K]");
+        attroff(A_BOLD);
+        attron(green);
+        printw(" to kill the process, press ");
+    }
+    attron(red);
+    attron(A_BOLD);
+    printw("[Q]");
+    attroff(A_BOLD);
+    attron(green);
+    printw(" to quit this page");
+    attron(red);
+}
+
+//bytes this thread wrote so far, the ui thread only writes to the terminal
+unsigned long long terminalBytesWritten() {
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "task/%ld/io", static_cast<long>(syscall(SYS_gettid)));
+    const std::string_view io = readProcFile(getpid(), fileName);
+    unsigned long long bytes = 0;
+    const size_t key = io.find("wchar:");
+    if (key != std::string_view::npos) {
+        parseNumber(statusValue(io.substr(key), "wchar:"), bytes);
+    }
+    return bytes;
+}
+
+//kill confirm screen for single file data display
+bool killConfirmation(const int pid) {
+    init_pair(22, COLOR_WHITE, COLOR_RED);
+    clear();
+    bkgd(COLOR_PAIR(22));
+    attron(A_BOLD);
+    std::string text1 = "Press [K] to kill this process";
+    std::string text2 = "Press [T] to terminate this process";
+    std::string text3 = "Press any other key to quit";
+    mvprintw(LINES/2, COLS/2 - text1.length()/2, "%s", text1.c_str());
+    mvprintw(LINES/2 + 1, COLS/2 - text2.length()/2, "%s", text2.c_str());
+    mvprintw(LINES/2 + 2, COLS/2 - text3.length()/2, "%s", text3.c_str());
+    attroff(A_BOLD);
+    const char ch = getch();
+    if (ch == 'k') {
+        return kill(pid, SIGKILL) == 0;
+
+    }
+    if (ch == 't') {
+        return kill(pid, SIGTERM) == 0;
+    }
+    return false;
+}
+
+//prints the border on the screen, offset moves it inside by x
+void printBorder(const chtype color, const int offset = 0) {
+    attron(color);
+    mvhline(0 + offset, 0 + offset, ACS_HLINE, COLS - offset * 2);
+    mvhline(LINES - 1 - offset, 0 + offset, ACS_HLINE, COLS - offset * 2);
+    mvvline(0 + offset, 0 + offset, ACS_VLINE, LINES - offset * 2);
+    mvvline(0 + offset, COLS - 1 - offset, ACS_VLINE, LINES - offset * 2);
+
+    mvaddch(0 + offset, 0 + offset, ACS_ULCORNER);
+    mvaddch(0 + offset, COLS - 1 - offset, ACS_URCORNER);
+    mvaddch(LINES - 1 - offset, 0 + offset, ACS_LLCORNER);
+    mvaddch(LINES - 1 - offset, COLS - 1 - offset, ACS_LRCORNER);
+    attroff(color);
+}
+
+//only handles the printing of data of a single file
+void printSingleProcessData(const Process& process, int line, int xOffset, const bool recorded = false) {
+    const chtype black = COLOR_PAIR(1);
+    const chtype red = COLOR_PAIR(2);
+    const chtype blue = COLOR_PAIR(3);
+    const chtype green = COLOR_PAIR(4);
+    //erase only blanks the window, refresh then sends the cells that changed instead of repainting the terminal
+    erase();
+    bkgd(green);
+
+    const int currentRamUsage = process.ramUsage > 1024 ? static_cast<float>(process.ramUsage) / 1024 : static_cast<float>(process.ramUsage);
+    const std::string postfixRam = process.ramUsage > 1024 ? " MB" : " kB";
+    const int currentSwapUsage = process.swapUsage > 1024 ? static_cast<float>(process.swapUsage) / 1024 : static_cast<float>(process.swapUsage);
+    const std::string postfixSwap = process.swapUsage > 1024 ? " MB" : " kB";
+
+    printQuitInstructions(line, xOffset, recorded);
+    line++;
+    printLine(line, xOffset, "Name: ", black, std::string(process.name), red, line);
+    printLine(line, xOffset, "PID: ", black, std::to_string(process.pid), red, line);
+    printLine(line, xOffset, "State: ", black, stateDescription(process.state), red, line);
+    printLine(line, xOffset, "RAM usage: ", black, std::to_string(currentRamUsage) + postfixRam, red, line);
+    char cpuUsage[16];
+    snprintf(cpuUsage, sizeof(cpuUsage), "%.1f%%", process.cpuUsage);
+    printLine(line, xOffset, "CPU usage: ", black, cpuUsage, red, line);
+    printLine(line, xOffset, "Process path: ", black, std::string(process.processPath), green, line);
+    printLine(line, xOffset, "PPID: ", black, std::to_string(process.ppid), blue, line);
+    printLine(line, xOffset, "Threads: ", black, std::to_string(process.threads), blue, line);
+    printLine(line, xOffset, "Swap usage: ", black, std::to_string(currentSwapUsage) + postfixSwap, blue, line);
+    printLine(line, xOffset, "Number of open file descriptors: ", black, std::to_string(process.numFileDescriptors), blue, line);
+    printLine(line, xOffset, "UID: ", black, std::to_string(process.uid), blue, line);
+    printLine(line, xOffset, "User: ", black, std::string(process.userName), red, line);
+
+}
+
+//prints the threads of the process below the details, as many as fit the screen
+void printThreads(const std::vector<ThreadInfo> &threads, const bool byCpu, int line, const int xOffset) {
+    const chtype black = COLOR_PAIR(1);
+    const chtype red = COLOR_PAIR(2);
+    const chtype blue = COLOR_PAIR(3);
+    const int lastLine = LINES - 3;
+    if (line > lastLine) {
+        return;
+    }
+    attron(black);
+    attron(A_BOLD);
+    mvprintw(line, xOffset, "Threads by %s, ", byCpu ? "CPU usage" : "TID");
+    attron(red);
+    printw("[S]");
+    attron(black);
+    printw(" to change: %-8s %-6s %-7s %s", "TID", "STATE", "CPU", "NAME");
+    line++;
+    size_t i = 0;
+    for (; i < threads.size() && line <= lastLine; i++, line++) {
+        attron(blue);
+        mvprintw(line, xOffset, "%-8d %-6c %5.1f%%  ", threads[i].tid, threads[i].state, threads[i].cpuUsage);
+        attron(red);
+        printw("%s", threads[i].name.c_str());
+    }
+    if (i < threads.size()) {
+        attron(black);
+        printw("   (+%zu more)", threads.size() - i);
+    }
+    attroff(A_BOLD);
+    attroff(red);
+}
+
+//makes the single process data screen, uses a shit ton of helpers
+void displaySingleProcessData(const Process &process, const int workerCount, const double interval) {
+    int line = 3;//starting line
+    int xOffset = 4;
+    const int threadsLine = line + 15;
+
+    const chtype borderColor = COLOR_PAIR(7);
+    std::vector<ThreadInfo> threads;
+    bool sortByCpu = true;
+    bool looping = true;
+    //the threads are read again at the refresh interval, the home screen polls faster for its snapshots
+    timeout(static_cast<int>(interval * 1000));
+    //a first sample shortly before the first screen, so the hottest threads are on top right away instead of after an interval
+    const int baselineMs = 100;
+    refreshThreads(process.pid, threads, workerCount);
+    napms(baselineMs);
+    while (looping) {
+        refreshThreads(process.pid, threads, workerCount);
+        sortThreads(threads, sortByCpu);
+        printSingleProcessData(process, line, xOffset );
+        printThreads(threads, sortByCpu, threadsLine, xOffset);
+        printBorder(borderColor);
+        printBorder(borderColor, 1);
+        char ch = getch();
+        switch (ch) {
+            case 'q':
+                looping = false;
+            break;
+            case 'k':
+                looping = !killConfirmation(process.pid);
+                break;
+            case 's':
+                sortByCpu = !sortByCpu;
+                break;
+            default:
+                break;
+        }
+    };
+    attroff(COLOR_PAIR(2));
+    bkgd(COLOR_PAIR(0));
+}
+
+//the single process screen of a replay, shows what was recorded, the pid may belong to another process by now
+void displayRecordedProcessData(const Process &process) {
+    const chtype borderColor = COLOR_PAIR(7);
+    int ch = ERR;
+    while (ch != 'q') {
+        printSingleProcessData(process, 3, 4, true);
+        printBorder(borderColor);
+        printBorder(borderColor, 1);
+        ch = getch();
+    }
+    attroff(COLOR_PAIR(2));
+    bkgd(COLOR_PAIR(0));
+}
+
+//helper function for the printMainQuitInstructions, prints 1st in normal, 2nd in bold, takes colors
+void printPair(std::string text1, std::string text2, chtype color1, chtype color2) {
+    attron(color1);
+    printClipped("%s", text1.c_str());
+    attroff(color1);
+    attron(A_BOLD);
+    attron(color2);
+    printClipped("%s", text2.c_str());
+    attroff(A_BOLD);
+    attroff(color2);
+}
+
+//quit instruction for home screen, two lines so the first one leaves room for the page count on its right
+void printMainQuitInstructions(const bool replay) {
+    init_pair(20, COLOR_GREEN, COLOR_BLACK);
+    chtype color = COLOR_PAIR(20);
+    chtype normal = COLOR_PAIR(0);
+    printPair("QUIT->", "[~]", normal, color);
+    printPair(" MODE->", "[M]", normal, color);
+    printPair(" SELECT->", "[NUMBER]", normal, color);
+    printPair(" USER->", "[U]", normal, color);
+    printPair(" SORT->", "[S]", normal, color);
+    printClipped("\n");
+    printPair("SEARCH->", "[/]", normal, color);
+    printPair(" FILTER->", "[F]", normal, color);
+    if (replay) {
+        printPair(" BACK/FORWARD->", "[,][.]", normal, color);
+        printPair(" GO TO->", "[G]", normal, color);
+    }
+    else {
+        printPair(" REFRESH->", "[R]", normal, color);
+    }
+    printClipped("\n");
+}
+
+//helper for sort, by RAM descending
+bool compareProcessesByRAM(const Process &process1, const Process &process2) {
+    return process1.ramUsage > process2.ramUsage;
+}
+
+//helper for sort, by name alphabetically
+bool compareProcessesByName(const Process &process1, const Process &process2) {
+    return process1.name < process2.name;
+}
+
+//helper for sort, by CPU usage descending
+bool compareProcessesByCPU(const Process &process1, const Process &process2) {
+    return process1.cpuUsage > process2.cpuUsage;
+}
+
+//helper for sort, by PID ascending
+bool compareProcessesByPID(const Process &process1, const Process &process2) {
+    return process1.pid < process2.pid;
+}
+
+//sorts by the current selected mode, the home screen sorts the column indexes, this is the reference for the benchmark
+void sortProcesses(std::vector<Process> &processes, std::string mode) {
+    if (mode == "RAM usage") {
+        std::sort(processes.begin(), processes.end(), compareProcessesByRAM);
+    }
+    if (mode == "Alphabet") {
+        std::sort(processes.begin(), processes.end(), compareProcessesByName);
+        return;
+    }
+    if (mode == "PID") {
+        std::sort(processes.begin(), processes.end(), compareProcessesByPID);
+        return;
+    }
+    if (mode == "CPU") {
+        std::sort(processes.begin(), processes.end(), compareProcessesByCPU);
+        return;
+    }
+}
+
+//the process table as contiguous columns, filters and sorts only touch the arrays they need and work on index lists
+struct ProcessColumns {
+    std::vector<int> pid;
+    std::vector<int> ppid;
+    std::vector<int> ramUsage;
+    std::vector<int> swapUsage;
+    std::vector<float> cpuUsage;
+    std::vector<char> state; //R/S/D/Z/T/I
+    std::vector<int> uid;
+    std::vector<uint16_t> user; //index into userNames
+    std::vector<uint32_t> nameOffset; //into names
+    std::vector<uint32_t> nameLength;
+    std::string names; //all names back to back
+    std::vector<std::string_view> userNames;
+};
+
+//sort keys of the columns, same order as the sort modes on the home screen
+enum class SortKey {
+    RAM, CPU, NAME, PID
+};
+
+//converts the sort mode shown on the home screen
+SortKey sortKeyOfMode(const std::string &mode) {
+    if (mode == "CPU") {
+        return SortKey::CPU;
+    }
+    if (mode == "Alphabet") {
+        return SortKey::NAME;
+    }
+    if (mode == "PID") {
+        return SortKey::PID;
+    }
+    return SortKey::RAM;
+}
+
+//converts the filter mode shown on the home screen to a state letter, 0 for ALL
+char stateOfMode(const std::string &mode) {
+    if (mode == "RUNNING") {
+        return 'R';
+    }
+    if (mode == "ZOMBIE") {
+        return 'Z';
+    }
+    if (mode == "SLEEPING") {
+        return 'S';
+    }
+    if (mode == "STOPPED") {
+        return 'T';
+    }
+    if (mode == "IDLE") {
+        return 'I';
+    }
+    return 0;
+}
+
+//fills the columns from the table, reuses their allocations
+void buildProcessColumns(const std::vector<Process> &processes, ProcessColumns &columns) {
+    const size_t size = processes.size();
+    columns.pid.resize(size);
+    columns.ppid.resize(size);
+    columns.ramUsage.resize(size);
+    columns.swapUsage.resize(size);
+    columns.cpuUsage.resize(size);
+    columns.state.resize(size);
+    columns.uid.resize(size);
+    columns.user.resize(size);
+    columns.nameOffset.resize(size);
+    columns.nameLength.resize(size);
+    columns.names.clear();
+    columns.userNames.clear();
+    std::unordered_map<std::string_view, uint16_t> userIndexes;
+    for (size_t i = 0; i < size; i++) {
+        const Process &process = processes[i];
+        columns.pid[i] = process.pid;
+        columns.ppid[i] = process.ppid;
+        columns.ramUsage[i] = process.ramUsage;
+        columns.swapUsage[i] = process.swapUsage;
+        columns.cpuUsage[i] = process.cpuUsage;
+        columns.state[i] = static_cast<char>(process.state);
+        columns.uid[i] = process.uid;
+        const auto user = userIndexes.try_emplace(process.userName, static_cast<uint16_t>(columns.userNames.size()));
+        if (user.second) {
+            columns.userNames.push_back(process.userName);
+        }
+        columns.user[i] = user.first->second;
+        columns.nameOffset[i] = static_cast<uint32_t>(columns.names.size());
+        columns.nameLength[i] = static_cast<uint32_t>(process.name.size());
+        columns.names += process.name;
+    }
+}
+
+//the name of row i
+std::string_view columnName(const ProcessColumns &columns, const uint32_t i) {
+    return std::string_view(columns.names).substr(columns.nameOffset[i], columns.nameLength[i]);
+}
+
+//sets the indexes to every row
+void allColumnIndexes(const ProcessColumns &columns, std::vector<uint32_t> &indexes) {
+    indexes.resize(columns.pid.size());
+    for (uint32_t i = 0; i < indexes.size(); i++) {
+        indexes[i] = i;
+    }
+}
+
+//keeps the indexes of the rows in the state, 0 keeps all
+void filterColumnsByState(const ProcessColumns &columns, const char state, std::vector<uint32_t> &indexes) {
+    if (state == 0) {
+        return;
+    }
+    std::erase_if(indexes, [&](const uint32_t i) {
+        return columns.state[i] != state;
+    });
+}
+
+//keeps the indexes of the rows of the user, an unknown user keeps all
+void filterColumnsByUser(const ProcessColumns &columns, const std::string_view userName, std::vector<uint32_t> &indexes) {
+    const auto user = std::find(columns.userNames.begin(), columns.userNames.end(), userName);
+    if (user == columns.userNames.end()) {
+        return;
+    }
+    const uint16_t userIndex = static_cast<uint16_t>(user - columns.userNames.begin());
+    std::erase_if(indexes, [&](const uint32_t i) {
+        return columns.user[i] != userIndex;
+    });
+}
+
+//calls work with the comparator of the sort key, RAM and CPU descending, name and PID ascending
+template <typename Work>
+void withColumnComparator(const ProcessColumns &columns, const SortKey key, const Work &work) {
+    switch (key) {
+        case SortKey::RAM:
+            work([&](const uint32_t a, const uint32_t b) {
+                return columns.ramUsage[a] > columns.ramUsage[b];
+            });
+        break;
+        case SortKey::CPU:
+            work([&](const uint32_t a, const uint32_t b) {
+                return columns.cpuUsage[a] > columns.cpuUsage[b];
+            });
+        break;
+        case SortKey::NAME:
+            work([&](const uint32_t a, const uint32_t b) {
+                return columnName(columns, a) < columnName(columns, b);
+            });
+        break;
+        case SortKey::PID:
+            work([&](const uint32_t a, const uint32_t b) {
+                return columns.pid[a] < columns.pid[b];
+            });
+        break;
+    }
+}
+
+//sorts the indexes by one column
+void sortColumnIndexes(const ProcessColumns &columns, std::vector<uint32_t> &indexes, const SortKey key) {
+    withColumnComparator(columns, key, [&](const auto &compare) {
+        std::sort(indexes.begin(), indexes.end(), compare);
+    });
+}
+
+//puts the rows that belong to positions [from, to) in order there, the positions before from must already be sorted
+void sortColumnIndexRange(const ProcessColumns &columns, std::vector<uint32_t> &indexes, const SortKey key, const size_t from, const size_t to) {
+    withColumnComparator(columns, key, [&](const auto &compare) {
+        if (to == indexes.size()) {
+            std::sort(indexes.begin() + from, indexes.end(), compare);
+        }
+        else {
+            std::partial_sort(indexes.begin() + from, indexes.begin() + to, indexes.end(), compare);
+        }
+    });
+}
+
+//sorts with a natural merge sort, linear on sorted input and close to it when only a few rows moved
+template <typename Compare>
+void adaptiveSort(std::vector<uint32_t> &indexes, const Compare &compare) {
+    //boundaries of the runs that are already in order
+    std::vector<size_t> runs = {0};
+    for (size_t i = 1; i < indexes.size(); i++) {
+        if (compare(indexes[i], indexes[i - 1])) {
+            runs.push_back(i);
+        }
+    }
+    runs.push_back(indexes.size());
+    while (runs.size() > 2) {
+        std::vector<size_t> merged = {0};
+        for (size_t r = 0; r + 2 < runs.size(); r += 2) {
+            std::inplace_merge(indexes.begin() + runs[r], indexes.begin() + runs[r + 1], indexes.begin() + runs[r + 2], compare);
+            merged.push_back(runs[r + 2]);
+        }
+        //an odd run is carried to the next pass
+        if ((runs.size() - 1) % 2 == 1) {
+            merged.push_back(runs.back());
+        }
+        runs = std::move(merged);
+    }
+}
+
+//a sort order of the table kept across refreshes, remembered by pid since the table rows move around
+struct PersistentOrder {
+    SortKey key;
+    std::vector<int> pids; //order of the last refresh
+    std::vector<uint32_t> rows; //the same order as rows of the current columns
+};
+
+//repairs the order for new columns, exited processes are dropped, new ones appended and the almost sorted rows sorted again
+void updatePersistentOrder(PersistentOrder &order, const ProcessColumns &columns, const std::unordered_map<int, size_t> &indexByPid) {
+    std::vector<char> placed(columns.pid.size(), 0);
+    order.rows.clear();
+    for (const int pid : order.pids) {
+        const auto it = indexByPid.find(pid);
+        if (it != indexByPid.end()) {
+            order.rows.push_back(static_cast<uint32_t>(it->second));
+            placed[it->second] = 1;
+        }
+    }
+    for (uint32_t i = 0; i < placed.size(); i++) {
+        if (!placed[i]) {
+            order.rows.push_back(i);
+        }
+    }
+    withColumnComparator(columns, order.key, [&](const auto &compare) {
+        adaptiveSort(order.rows, compare);
+    });
+    order.pids.resize(order.rows.size());
+    for (size_t i = 0; i < order.rows.size(); i++) {
+        order.pids[i] = columns.pid[order.rows[i]];
+    }
+}
+
+//an n-gram index over the lowercased name and exe path of the processes, for the search bar
+//processes sharing a name and path share one document, the documents are kept across refreshes and only
+//processes that started, exited or exec'd are indexed again
+struct SearchIndex {
+    struct Document {
+        std::string_view name; //interned, equal strings have equal pointers
+        std::string_view processPath;
+        size_t textOffset;
+        uint32_t textLength;
+        uint32_t processes; //0 once every process with this name and path exited
+    };
+    struct DocumentKey {
+        const char *name;
+        const char *processPath;
+        bool operator==(const DocumentKey &other) const = default;
+    };
+    struct DocumentKeyHash {
+        size_t operator()(const DocumentKey &key) const {
+            return std::hash<const void *>()(key.name) * 31 + std::hash<const void *>()(key.processPath);
+        }
+    };
+    std::vector<Document> documents; //never reused, dead documents are dropped when the index is rebuilt
+    std::unordered_map<DocumentKey, uint32_t, DocumentKeyHash> documentByKey;
+    std::unordered_map<int, uint32_t> documentByPid;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings; //gram of one to three characters -> documents containing it
+    std::string text; //lowercased "name\npath" of every document
+    size_t liveDocuments = 0;
+    unsigned long long generation = 0;
+    std::vector<uint32_t> documentOfRow; //document of every row of the current table
+
+    //the last search, a query containing it only has to check its matches again
+    std::string lastQuery;
+    unsigned long long lastGeneration = 0;
+    std::vector<uint32_t> lastMatches;
+    std::vector<char> matchedDocuments;
+};
+
+char lowerAscii(const char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+//the characters of the gram with its length on top, so "ab" and "\0ab" differ
+uint32_t packGram(const char *text, const size_t length) {
+    uint32_t gram = static_cast<uint32_t>(length) << 24;
+    for (size_t i = 0; i < length; i++) {
+        gram |= static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << (8 * (length - 1 - i));
+    }
+    return gram;
+}
+
+//the document of the process's name and path, indexed if it is new
+uint32_t acquireSearchDocument(SearchIndex &index, const Process &process) {
+    const auto [it, inserted] = index.documentByKey.try_emplace({process.name.data(), process.processPath.data()}, 0);
+    if (!inserted) {
+        SearchIndex::Document &document = index.documents[it->second];
+        if (document.processes++ == 0) {
+            index.liveDocuments++;
+        }
+        return it->second;
+    }
+    const uint32_t id = static_cast<uint32_t>(index.documents.size());
+    const size_t offset = index.text.size();
+    for (const char c : process.name) {
+        index.text.push_back(lowerAscii(c));
+    }
+    index.text.push_back('\n');
+    for (const char c : process.processPath) {
+        index.text.push_back(lowerAscii(c));
+    }
+    const uint32_t length = static_cast<uint32_t>(index.text.size() - offset);
+    index.documents.push_back({process.name, process.processPath, offset, length, 1});
+    index.liveDocuments++;
+    it->second = id;
+
+    thread_local std::vector<uint32_t> grams;
+    grams.clear();
+    for (uint32_t i = 0; i < length; i++) {
+        for (uint32_t gramLength = 1; gramLength <= 3 && i + gramLength <= length; gramLength++) {
+            grams.push_back(packGram(index.text.data() + offset + i, gramLength));
+        }
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    for (const uint32_t gram : grams) {
+        index.postings[gram].push_back(id);
+    }
+    return id;
+}
+
+void releaseSearchDocument(SearchIndex &index, const uint32_t id) {
+    if (--index.documents[id].processes == 0) {
+        index.liveDocuments--;
+    }
+}
+
+//brings the index up to the table, rebuilt from scratch once more than half of it are dead documents
+void updateSearchIndex(SearchIndex &index, const std::vector<Process> &processes) {
+    index.generation++;
+    if (index.documents.size() - index.liveDocuments > index.liveDocuments + 1024) {
+        index.documents.clear();
+        index.documentByKey.clear();
+        index.documentByPid.clear();
+        index.postings.clear();
+        index.text.clear();
+        index.liveDocuments = 0;
+    }
+    //a pid whose name or path changed moves to another document, pids left over have exited
+    std::unordered_map<int, uint32_t> previous;
+    previous.swap(index.documentByPid);
+    index.documentByPid.reserve(processes.size());
+    index.documentOfRow.resize(processes.size());
+    for (uint32_t row = 0; row < processes.size(); row++) {
+        const Process &process = processes[row];
+        uint32_t id;
+        const auto it = previous.find(process.pid);
+        if (it != previous.end() && index.documents[it->second].name.data() == process.name.data()
+            && index.documents[it->second].processPath.data() == process.processPath.data()) {
+            id = it->second;
+            previous.erase(it);
+        }
+        else {
+            id = acquireSearchDocument(index, process);
+        }
+        index.documentByPid[process.pid] = id;
+        index.documentOfRow[row] = id;
+    }
+    for (const auto &[pid, id] : previous) {
+        releaseSearchDocument(index, id);
+    }
+}
+
+//live documents whose name or exe path contains the query, ignoring case
+//a query of up to three characters is its own posting list, a longer one checks the documents of its rarest trigram
+//or the matches of the shorter query it extends against the text
+const std::vector<uint32_t> &searchDocuments(SearchIndex &index, const std::string_view query) {
+    std::string lowered(query.size(), '\0');
+    std::transform(query.begin(), query.end(), lowered.begin(), lowerAscii);
+    if (index.lastGeneration == index.generation && lowered == index.lastQuery) {
+        return index.lastMatches;
+    }
+
+    static const std::vector<uint32_t> noCandidates;
+    //the search stage is only set for a query, an empty one matches nothing
+    const std::vector<uint32_t> *candidates = &noCandidates;
+    const size_t gramLength = std::min<size_t>(lowered.size(), 3);
+    const bool exact = lowered.size() <= 3;
+    if (!lowered.empty()) {
+        for (size_t i = 0; i + gramLength <= lowered.size(); i++) {
+            const auto posting = index.postings.find(packGram(lowered.data() + i, gramLength));
+            if (posting == index.postings.end()) {
+                candidates = &noCandidates;
+                break;
+            }
+            if (i == 0 || posting->second.size() < candidates->size()) {
+                candidates = &posting->second;
+            }
+        }
+    }
+    const bool narrowing = index.lastGeneration == index.generation && !index.lastQuery.empty()
+        && lowered.find(index.lastQuery) != std::string::npos;
+    std::vector<uint32_t> previous;
+    if (narrowing && !exact && index.lastMatches.size() < candidates->size()) {
+        previous.swap(index.lastMatches);
+        candidates = &previous;
+    }
+
+    index.lastMatches.clear();
+    const std::string_view text = index.text;
+    auto check = [&](const uint32_t id) {
+        const SearchIndex::Document &document = index.documents[id];
+        if (document.processes > 0 && (exact || text.substr(document.textOffset, document.textLength).find(lowered) != std::string_view::npos)) {
+            index.lastMatches.push_back(id);
+        }
+    };
+    for (const uint32_t id : *candidates) {
+        check(id);
+    }
+    index.lastQuery = lowered;
+    index.lastGeneration = index.generation;
+    return index.lastMatches;
+}
+
+//keeps the indexes of processes matching the search, in their order
+void filterColumnsBySearch(const ProcessColumns &, SearchIndex &index, const std::string_view query, std::vector<uint32_t> &indexes) {
+    index.matchedDocuments.assign(index.documents.size(), 0);
+    for (const uint32_t id : searchDocuments(index, query)) {
+        index.matchedDocuments[id] = 1;
+    }
+    //branchless, a search keeps a scattered few of the rows
+    size_t kept = 0;
+    for (const uint32_t i : indexes) {
+        indexes[kept] = i;
+        kept += index.matchedDocuments[index.documentOfRow[i]];
+    }
+    indexes.resize(kept);
+}
+
+//fields of the filter expressions, each one a column of ProcessColumns
+enum class FilterField {
+    PID, PPID, RSS, SWAP, CPU, STATE, UID, USER, NAME
+};
+
+//one step of a compiled filter in postfix order, a comparison or a logic op over the subexpressions before it
+struct FilterInstruction {
+    enum Op {
+        EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, IN, MATCH, AND, OR, NOT
+    } op;
+    size_t start = 0; //first instruction of the subexpression this one ends, the operands of a logic op are found through it
+    FilterField field = FilterField::PID;
+    std::vector<double> numbers; //constants of the numeric fields
+    std::vector<std::string> strings; //constants of state, user and name, MATCH ones are lowercased
+};
+
+//a filter expression like: rss > 500M and user in (www, app) and state in (R, D) and name ~ "java"
+//parsed once into postfix order, so refreshes only run the instructions over the columns
+//and / or short-circuit, the right operand only sees the rows the left one did not decide
+struct FilterProgram {
+    std::string text;
+    std::vector<FilterInstruction> instructions;
+};
+
+struct FilterToken {
+    enum Type {
+        WORD, STRING, SYMBOL, END
+    } type;
+    std::string text;
+};
+
+struct FilterParser {
+    std::vector<FilterToken> tokens;
+    size_t position = 0;
+    FilterProgram &program;
+    std::string &error;
+};
+
+bool tokenizeFilter(const std::string_view text, std::vector<FilterToken> &tokens, std::string &error) {
+    const std::string_view symbols = "()<>=!~,";
+    size_t i = 0;
+    while (i < text.size()) {
+        const char c = text[i];
+        if (c == ' ' || c == '\t') {
+            i++;
+        }
+        else if (c == '"') {
+            const size_t end = text.find('"', i + 1);
+            if (end == std::string_view::npos) {
+                error = "unterminated string";
+                return false;
+            }
+            tokens.push_back({FilterToken::STRING, std::string(text.substr(i + 1, end - i - 1))});
+            i = end + 1;
+        }
+        else if (symbols.find(c) != std::string_view::npos) {
+            //two character operators
+            const std::string_view pair = text.substr(i, 2);
+            const size_t length = pair == "<=" || pair == ">=" || pair == "==" || pair == "!=" ? 2 : 1;
+            tokens.push_back({FilterToken::SYMBOL, std::string(text.substr(i, length))});
+            i += length;
+        }
+        else {
+            const size_t start = i;
+            while (i < text.size() && text[i] != ' ' && text[i] != '\t' && text[i] != '"' && symbols.find(text[i]) == std::string_view::npos) {
+                i++;
+            }
+            tokens.push_back({FilterToken::WORD, std::string(text.substr(start, i - start))});
+        }
+    }
+    tokens.push_back({FilterToken::END, ""});
+    return true;
+}
+
+bool isFilterKeyword(const FilterToken &token, const std::string_view keyword) {
+    if (token.type != FilterToken::WORD || token.text.size() != keyword.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < keyword.size(); i++) {
+        if (lowerAscii(token.text[i]) != keyword[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseFilterField(const std::string_view name, FilterField &field) {
+    static const std::vector<std::pair<std::string_view, FilterField>> fields = {
+        {"pid", FilterField::PID}, {"ppid", FilterField::PPID}, {"rss", FilterField::RSS}, {"ram", FilterField::RSS},
+        {"swap", FilterField::SWAP}, {"cpu", FilterField::CPU}, {"state", FilterField::STATE}, {"uid", FilterField::UID},
+        {"user", FilterField::USER}, {"name", FilterField::NAME}
+    };
+    for (const auto &[fieldName, value] : fields) {
+        if (fieldName == name) {
+            field = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isNumericField(const FilterField field) {
+    return field != FilterField::STATE && field != FilterField::USER && field != FilterField::NAME;
+}
+
+//converts a constant for the field, sizes are in kB like the columns and take a K/M/G/T suffix
+bool parseFilterValue(FilterParser &parser, const FilterField field, FilterInstruction &instruction) {
+    const FilterToken &token = parser.tokens[parser.position];
+    if (token.type != FilterToken::WORD && token.type != FilterToken::STRING) {
+        parser.error = "expected a value";
+        return false;
+    }
+    parser.position++;
+    if (!isNumericField(field)) {
+        if (field == FilterField::STATE && (token.text.size() != 1 || parseState(token.text[0]) == ProcessState::UNKNOWN)) {
+            parser.error = "unknown state '" + token.text + "'";
+            return false;
+        }
+        instruction.strings.push_back(token.text);
+        return true;
+    }
+
+    double value = 0;
+    const char *end = token.text.data() + token.text.size();
+    const auto [rest, result] = std::from_chars(token.text.data(), end, value);
+    if (result != std::errc() || rest == token.text.data()) {
+        parser.error = "expected a number, got '" + token.text + "'";
+        return false;
+    }
+    const std::string_view suffix(rest, end - rest);
+    const bool size = field == FilterField::RSS || field == FilterField::SWAP;
+    const size_t unit = suffix.size() == 1 ? std::string_view("kmgt").find(lowerAscii(suffix[0])) : std::string_view::npos;
+    if (size && unit != std::string_view::npos) {
+        for (size_t i = 0; i < unit; i++) {
+            value *= 1024;
+        }
+    }
+    else if (!suffix.empty() && !(field == FilterField::CPU && suffix == "%")) {
+        parser.error = "unexpected '" + std::string(suffix) + "' after a number";
+        return false;
+    }
+    instruction.numbers.push_back(value);
+    return true;
+}
+
+bool parseFilterOr(FilterParser &parser);
+
+//field op value, field in (value, ...) or a parenthesized expression
+bool parseFilterPrimary(FilterParser &parser) {
+    const FilterToken &token = parser.tokens[parser.position];
+    if (token.type == FilterToken::SYMBOL && token.text == "(") {
+        parser.position++;
+        if (!parseFilterOr(parser)) {
+            return false;
+        }
+        if (parser.tokens[parser.position].text != ")" || parser.tokens[parser.position].type != FilterToken::SYMBOL) {
+            parser.error = "expected ')'";
+            return false;
+        }
+        parser.position++;
+        return true;
+    }
+
+    FilterInstruction instruction{};
+    if (token.type != FilterToken::WORD || !parseFilterField(token.text, instruction.field)) {
+        parser.error = token.type == FilterToken::END ? "expected a field" : "unknown field '" + token.text + "'";
+        return false;
+    }
+    parser.position++;
+    const FilterToken &op = parser.tokens[parser.position];
+    static const std::vector<std::pair<std::string_view, FilterInstruction::Op>> operators = {
+        {"=", FilterInstruction::EQUAL}, {"==", FilterInstruction::EQUAL}, {"!=", FilterInstruction::NOT_EQUAL},
+        {"<", FilterInstruction::LESS}, {"<=", FilterInstruction::LESS_EQUAL}, {">", FilterInstruction::GREATER},
+        {">=", FilterInstruction::GREATER_EQUAL}, {"~", FilterInstruction::MATCH}
+    };
+    const auto found = std::find_if(operators.begin(), operators.end(), [&op](const auto &entry) {
+        return op.type == FilterToken::SYMBOL && entry.first == op.text;
+    });
+    if (isFilterKeyword(op, "in")) {
+        instruction.op = FilterInstruction::IN;
+    }
+    else if (found != operators.end()) {
+        instruction.op = found->second;
+    }
+    else {
+        parser.error = "expected an operator after '" + token.text + "'";
+        return false;
+    }
+    parser.position++;
+
+    const bool ordering = instruction.op == FilterInstruction::LESS || instruction.op == FilterInstruction::LESS_EQUAL
+        || instruction.op == FilterInstruction::GREATER || instruction.op == FilterInstruction::GREATER_EQUAL;
+    if (ordering && !isNumericField(instruction.field)) {
+        parser.error = "'" + token.text + "' can not be ordered";
+        return false;
+    }
+    if (instruction.op == FilterInstruction::MATCH && instruction.field != FilterField::USER && instruction.field != FilterField::NAME) {
+        parser.error = "'~' only matches user and name";
+        return false;
+    }
+
+    if (instruction.op == FilterInstruction::IN) {
+        if (parser.tokens[parser.position].text != "(") {
+            parser.error = "expected '(' after in";
+            return false;
+        }
+        do {
+            parser.position++;
+            if (!parseFilterValue(parser, instruction.field, instruction)) {
+                return false;
+            }
+        } while (parser.tokens[parser.position].type == FilterToken::SYMBOL && parser.tokens[parser.position].text == ",");
+        if (parser.tokens[parser.position].text != ")") {
+            parser.error = "expected ')' after the values";
+            return false;
+        }
+        parser.position++;
+    }
+    else if (!parseFilterValue(parser, instruction.field, instruction)) {
+        return false;
+    }
+    if (instruction.op == FilterInstruction::MATCH) {
+        std::transform(instruction.strings[0].begin(), instruction.strings[0].end(), instruction.strings[0].begin(), lowerAscii);
+    }
+    instruction.start = parser.program.instructions.size();
+    parser.program.instructions.push_back(std::move(instruction));
+    return true;
+}
+
+//appends a logic op over the last one (not) or two (and, or) subexpressions
+void addFilterLogic(FilterProgram &program, const FilterInstruction::Op op) {
+    std::vector<FilterInstruction> &instructions = program.instructions;
+    size_t start = instructions.back().start;
+    if (op != FilterInstruction::NOT) {
+        start = instructions[start - 1].start;
+    }
+    instructions.emplace_back();
+    instructions.back().op = op;
+    instructions.back().start = start;
+}
+
+bool parseFilterNot(FilterParser &parser) {
+    if (isFilterKeyword(parser.tokens[parser.position], "not")) {
+        parser.position++;
+        if (!parseFilterNot(parser)) {
+            return false;
+        }
+        addFilterLogic(parser.program, FilterInstruction::NOT);
+        return true;
+    }
+    return parseFilterPrimary(parser);
+}
+
+bool parseFilterAnd(FilterParser &parser) {
+    if (!parseFilterNot(parser)) {
+        return false;
+    }
+    while (isFilterKeyword(parser.tokens[parser.position], "and")) {
+        parser.position++;
+        if (!parseFilterNot(parser)) {
+            return false;
+        }
+        addFilterLogic(parser.program, FilterInstruction::AND);
+    }
+    return true;
+}
+
+bool parseFilterOr(FilterParser &parser) {
+    if (!parseFilterAnd(parser)) {
+        return false;
+    }
+    while (isFilterKeyword(parser.tokens[parser.position], "or")) {
+        parser.position++;
+        if (!parseFilterAnd(parser)) {
+            return false;
+        }
+        addFilterLogic(parser.program, FilterInstruction::OR);
+    }
+    return true;
+}
+
+//parses the expression into the program, returns false and the reason on a syntax error
+bool compileFilter(const std::string_view text, FilterProgram &program, std::string &error) {
+    program.text = std::string(text);
+    program.instructions.clear();
+    FilterParser parser{{}, 0, program, error};
+    if (!tokenizeFilter(text, parser.tokens, error)) {
+        return false;
+    }
+    //an empty expression filters nothing
+    if (parser.tokens.front().type == FilterToken::END) {
+        return true;
+    }
+    if (!parseFilterOr(parser)) {
+        return false;
+    }
+    if (parser.tokens[parser.position].type != FilterToken::END) {
+        error = "unexpected '" + parser.tokens[parser.position].text + "'";
+        return false;
+    }
+    return true;
+}
+
+//keeps the positions into indexes whose row passes, branchless since most filters drop a scattered part of the rows
+template <typename Pass>
+void keepFilterPositions(std::vector<uint32_t> &positions, const std::vector<uint32_t> &indexes, const Pass &pass) {
+    size_t kept = 0;
+    for (const uint32_t position : positions) {
+        positions[kept] = position;
+        kept += pass(indexes[position]);
+    }
+    positions.resize(kept);
+}
+
+template <typename T>
+void compareFilterColumn(const std::vector<T> &column, const FilterInstruction &instruction, const std::vector<uint32_t> &indexes, std::vector<uint32_t> &positions) {
+    const double value = instruction.numbers[0];
+    switch (instruction.op) {
+        case FilterInstruction::EQUAL:
+            keepFilterPositions(positions, indexes, [&](const uint32_t i) { return column[i] == value; });
+            return;
+        case FilterInstruction::NOT_EQUAL:
+            keepFilterPositions(positions, indexes, [&](const uint32_t i) { return column[i] != value; });
+            return;
+        case FilterInstruction::LESS:
+            keepFilterPositions(positions, indexes, [&](const uint32_t i) { return column[i] < value; });
+            return;
+        case FilterInstruction::LESS_EQUAL:
+            keepFilterPositions(positions, indexes, [&](const uint32_t i) { return column[i] <= value; });
+            return;
+        case FilterInstruction::GREATER:
+            keepFilterPositions(positions, indexes, [&](const uint32_t i) { return column[i] > value; });
+            return;
+        case FilterInstruction::GREATER_EQUAL:
+            keepFilterPositions(positions, indexes, [&](const uint32_t i) { return column[i] >= value; });
+            return;
+        default:
+            keepFilterPositions(positions, indexes, [&](const uint32_t i) {
+                return std::find(instruction.numbers.begin(), instruction.numbers.end(), column[i]) != instruction.numbers.end();
+            });
+            return;
+    }
+}
+
+bool matchesFilterString(const FilterInstruction &instruction, const std::string_view text) {
+    if (instruction.op == FilterInstruction::MATCH) {
+        const std::string &pattern = instruction.strings[0];
+        return std::search(text.begin(), text.end(), pattern.begin(), pattern.end(), [](const char a, const char b) {
+            return lowerAscii(a) == b;
+        }) != text.end();
+    }
+    const bool found = std::find(instruction.strings.begin(), instruction.strings.end(), text) != instruction.strings.end();
+    return instruction.op == FilterInstruction::NOT_EQUAL ? !found : found;
+}
+
+//keeps the positions passing one comparison
+void runFilterComparison(const ProcessColumns &columns, const FilterInstruction &instruction, const std::vector<uint32_t> &indexes, std::vector<uint32_t> &positions) {
+    switch (instruction.field) {
+        case FilterField::PID: compareFilterColumn(columns.pid, instruction, indexes, positions); return;
+        case FilterField::PPID: compareFilterColumn(columns.ppid, instruction, indexes, positions); return;
+        case FilterField::RSS: compareFilterColumn(columns.ramUsage, instruction, indexes, positions); return;
+        case FilterField::SWAP: compareFilterColumn(columns.swapUsage, instruction, indexes, positions); return;
+        case FilterField::CPU: compareFilterColumn(columns.cpuUsage, instruction, indexes, positions); return;
+        case FilterField::UID: compareFilterColumn(columns.uid, instruction, indexes, positions); return;
+        case FilterField::STATE: {
+            //a table over the state letters, evaluated once instead of per row
+            bool passes[256];
+            for (int c = 0; c < 256; c++) {
+                const char letter = static_cast<char>(c);
+                passes[c] = matchesFilterString(instruction, std::string_view(&letter, 1));
+            }
+            keepFilterPositions(positions, indexes, [&](const uint32_t i) {
+                return passes[static_cast<unsigned char>(columns.state[i])];
+            });
+            return;
+        }
+        case FilterField::USER: {
+            //same for the few users of the snapshot
+            std::vector<char> passes(columns.userNames.size());
+            for (size_t u = 0; u < columns.userNames.size(); u++) {
+                passes[u] = matchesFilterString(instruction, columns.userNames[u]);
+            }
+            keepFilterPositions(positions, indexes, [&](const uint32_t i) {
+                return passes[columns.user[i]];
+            });
+            return;
+        }
+        case FilterField::NAME:
+            keepFilterPositions(positions, indexes, [&](const uint32_t i) {
+                return matchesFilterString(instruction, columnName(columns, i));
+            });
+            return;
+    }
+}
+
+//keeps the positions passing the subexpression that ends at instruction end, positions stay ascending
+void runFilterInstruction(const ProcessColumns &columns, const FilterProgram &program, const size_t end, const std::vector<uint32_t> &indexes, std::vector<uint32_t> &positions) {
+    const FilterInstruction &instruction = program.instructions[end];
+    if (instruction.op == FilterInstruction::AND) {
+        runFilterInstruction(columns, program, program.instructions[end - 1].start - 1, indexes, positions);
+        runFilterInstruction(columns, program, end - 1, indexes, positions);
+    }
+    else if (instruction.op == FilterInstruction::OR || instruction.op == FilterInstruction::NOT) {
+        //the positions the operand passed are taken out of the rest
+        std::vector<uint32_t> passed = positions;
+        runFilterInstruction(columns, program, instruction.op == FilterInstruction::OR ? program.instructions[end - 1].start - 1 : end - 1, indexes, passed);
+        std::vector<uint32_t> rest;
+        std::set_difference(positions.begin(), positions.end(), passed.begin(), passed.end(), std::back_inserter(rest));
+        if (instruction.op == FilterInstruction::NOT) {
+            positions.swap(rest);
+            return;
+        }
+        runFilterInstruction(columns, program, end - 1, indexes, rest);
+        positions.clear();
+        std::merge(passed.begin(), passed.end(), rest.begin(), rest.end(), std::back_inserter(positions));
+    }
+    else {
+        runFilterComparison(columns, instruction, indexes, positions);
+    }
+}
+
+//keeps the indexes that pass the program, in their order
+void filterColumnsByProgram(const ProcessColumns &columns, const FilterProgram &program, std::vector<uint32_t> &indexes) {
+    if (program.instructions.empty()) {
+        return;
+    }
+    std::vector<uint32_t> positions(indexes.size());
+    for (uint32_t k = 0; k < positions.size(); k++) {
+        positions[k] = k;
+    }
+    runFilterInstruction(columns, program, program.instructions.size() - 1, indexes, positions);
+    for (size_t k = 0; k < positions.size(); k++) {
+        indexes[k] = indexes[positions[k]];
+    }
+    indexes.resize(positions.size());
+}
+
+//a filter or sort of the home screen, refines the indexes left by the stage before it
+struct ViewStage {
+    std::function<void(const ProcessColumns &, std::vector<uint32_t> &)> apply;
+    std::vector<uint32_t> indexes; //result of this stage
+};
+
+//the stages of the home screen over one snapshot, changing a stage only recomputes it and the stages after it
+//every stage works on row indexes, no Process is copied
+//the indexes of the last stage are only sorted as far as the pages shown so far need
+struct ViewPipeline {
+    std::vector<ViewStage> stages;
+    size_t validStages = 0; //stages whose indexes are up to date
+    SortKey sortKey = SortKey::RAM;
+    size_t sortedCount = 0; //leading indexes of the last stage that are in sort order
+    const std::vector<uint32_t> *source = nullptr; //rows already in sortKey order, the filters keep that order
+};
+
+//the filter stages of the home screen pipeline, in order
+enum ViewStageIndex {
+    STATE_STAGE, USER_STAGE, FILTER_STAGE, SEARCH_STAGE
+};
+
+//replaces one stage, a stage without apply passes the indexes through
+void setViewStage(ViewPipeline &pipeline, const size_t index, std::function<void(const ProcessColumns &, std::vector<uint32_t> &)> apply) {
+    if (pipeline.stages.size() <= index) {
+        pipeline.stages.resize(index + 1);
+    }
+    pipeline.stages[index].apply = std::move(apply);
+    pipeline.validStages = std::min(pipeline.validStages, index);
+}
+
+//changes the sort, the filtered indexes are kept and only sorted again
+void setViewSort(ViewPipeline &pipeline, const SortKey key) {
+    pipeline.sortKey = key;
+    pipeline.sortedCount = 0;
+}
+
+//starts the first stage from rows already in the sort order instead of every row, nullptr for every row
+void setViewSource(ViewPipeline &pipeline, const std::vector<uint32_t> *source) {
+    pipeline.source = source;
+    pipeline.validStages = 0;
+}
+
+//the columns changed, every stage has to run again
+void invalidateView(ViewPipeline &pipeline) {
+    pipeline.validStages = 0;
+}
+
+//runs the stages that aren't up to date and returns the indexes left by the stage
+std::vector<uint32_t> &evaluateView(ViewPipeline &pipeline, const ProcessColumns &columns, const size_t lastStage) {
+    for (size_t i = pipeline.validStages; i <= lastStage; i++) {
+        ViewStage &stage = pipeline.stages[i];
+        if (i == 0 && pipeline.source) {
+            stage.indexes.assign(pipeline.source->begin(), pipeline.source->end());
+        }
+        else if (i == 0) {
+            allColumnIndexes(columns, stage.indexes);
+        }
+        else {
+            stage.indexes.assign(pipeline.stages[i - 1].indexes.begin(), pipeline.stages[i - 1].indexes.end());
+        }
+        if (stage.apply) {
+            stage.apply(columns, stage.indexes);
+        }
+        if (i == pipeline.stages.size() - 1) {
+            pipeline.sortedCount = pipeline.source ? stage.indexes.size() : 0;
+        }
+        pipeline.validStages = i + 1;
+    }
+    return pipeline.stages[lastStage].indexes;
+}
+
+//runs every stage and sorts the result far enough that the first count indexes are in order
+//paging forward extends the sorted prefix by at least doubling it, so a full sort only happens on the last pages
+const std::vector<uint32_t> &evaluateSortedView(ViewPipeline &pipeline, const ProcessColumns &columns, size_t count) {
+    std::vector<uint32_t> &indexes = evaluateView(pipeline, columns, pipeline.stages.size() - 1);
+    count = std::min(count, indexes.size());
+    if (count > pipeline.sortedCount) {
+        const size_t target = std::min(indexes.size(), std::max(count, pipeline.sortedCount * 2));
+        sortColumnIndexRange(columns, indexes, pipeline.sortKey, pipeline.sortedCount, target);
+        pipeline.sortedCount = target;
+    }
+    return indexes;
+}
+
+//the fields of a recorded process, in the order of the bits of its change mask
+enum RecordField {
+    RECORD_PPID,
+    RECORD_NAME,
+    RECORD_PATH,
+    RECORD_USER,
+    RECORD_UID,
+    RECORD_STATE,
+    RECORD_THREADS,
+    RECORD_RSS,
+    RECORD_SWAP,
+    RECORD_FDS,
+    RECORD_CPU,
+    RECORD_START,
+    RECORD_FIELD_COUNT
+};
+
+//a process as a recording stores it, the strings are ids into the string table and the cpu usage is in tenths of a percent
+struct RecordedProcess {
+    int pid = 0;
+    std::array<long long, RECORD_FIELD_COUNT> fields{};
+};
+
+//the values of the whole system in a record
+struct RecordedSystem {
+    long long cpuTenths = 0;
+    long long maxRam = 0; //MB, like Statistics
+    long long freeRam = 0;
+    long long usedRam = 0;
+};
+
+//what the collector hands to the recorder, a copy of the table when a snapshot is published
+struct RecordedSample {
+    long long time = 0; //milliseconds since the epoch
+    RecordedSystem system;
+    std::vector<Process> processes;
+    StringPoolHold pools;
+};
+
+//a recording is one file, a 64 byte header and then a ring of records that overwrites the oldest ones when it is full
+//records are a 16 byte RecordHeader and a payload of varints:
+//  the RecordedSystem, the strings added to the table (count, then length and bytes of each),
+//  the pids that exited (count, then the gaps between the ascending pids),
+//  the processes that started or changed (count, then for each the pid gap, a mask of the fields that changed
+//  and the difference of each of them zigzag encoded)
+//a keyframe starts from no processes and an empty string table, a delta from the record before it
+//integers are in the byte order of the machine that recorded
+const char recordingMagic[8] = {'P', 'M', 'R', 'E', 'C', '0', '0', '1'};
+
+struct RecordingHeader {
+    char magic[8];
+    uint64_t capacity; //bytes of the ring after the header
+    uint64_t tail; //ring offset of the oldest record, always a keyframe
+    uint64_t head; //ring offset the next record goes to
+    uint64_t records; //records from tail to head
+    uint64_t unused[3];
+};
+static_assert(sizeof(RecordingHeader) == 64);
+
+enum RecordKind : uint8_t {
+    KEYFRAME_RECORD = 1,
+    DELTA_RECORD,
+    WRAP_RECORD //the rest of the ring is unused, the next record is at offset 0
+};
+
+struct RecordHeader {
+    uint32_t size; //payload bytes after the header
+    uint8_t kind;
+    uint8_t unused[3];
+    int64_t time; //milliseconds since the epoch
+};
+static_assert(sizeof(RecordHeader) == 16);
+
+//a delta builds on at most this many records before it
+const int keyframeInterval = 32;
+
+void appendVarint(std::string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+//zigzag encoded, so small negative numbers stay short
+void appendSignedVarint(std::string &out, const long long value) {
+    appendVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+bool readVarint(const char *&data, const char *end, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && data < end; shift += 7) {
+        const auto byte = static_cast<uint8_t>(*data++);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool readSignedVarint(const char *&data, const char *end, long long &value) {
+    uint64_t encoded;
+    if (!readVarint(data, end, encoded)) {
+        return false;
+    }
+    value = static_cast<long long>(encoded >> 1) ^ -static_cast<long long>(encoded & 1);
+    return true;
+}
+
+//the state the records are encoded against, owned by the recorder thread
+struct RecordEncoder {
+    std::unordered_map<std::string_view, uint32_t> stringIds; //strings written since the last keyframe, the views are interned
+    StringPoolHold pools; //the arenas of the views in stringIds
+    std::vector<std::string_view> newStrings;
+    std::vector<RecordedProcess> previous; //sorted by pid
+    std::vector<RecordedProcess> current;
+    int sinceKeyframe = 0;
+    std::string payload;
+    std::string exited;
+    std::string changed;
+};
+
+uint32_t recordStringId(RecordEncoder &encoder, const std::string_view text) {
+    const auto [it, added] = encoder.stringIds.try_emplace(text, static_cast<uint32_t>(encoder.stringIds.size()));
+    if (added) {
+        encoder.newStrings.push_back(text);
+    }
+    return it->second;
+}
+
+//encodes the sample into encoder.payload, against the previous one unless it is a keyframe
+void encodeSample(RecordEncoder &encoder, const RecordedSample &sample, const bool keyframe) {
+    if (keyframe) {
+        encoder.stringIds.clear();
+        encoder.previous.clear();
+        encoder.sinceKeyframe = 0;
+    }
+    encoder.sinceKeyframe++;
+    encoder.current.clear();
+    for (const Process &process : sample.processes) {
+        RecordedProcess &recorded = encoder.current.emplace_back();
+        recorded.pid = process.pid;
+        recorded.fields = {
+            process.ppid,
+            recordStringId(encoder, process.name),
+            recordStringId(encoder, process.processPath),
+            recordStringId(encoder, process.userName),
+            process.uid,
+            static_cast<char>(process.state),
+            process.threads,
+            process.ramUsage,
+            process.swapUsage,
+            process.numFileDescriptors,
+            std::lround(process.cpuUsage * 10),
+            static_cast<long long>(process.startTime)
+        };
+    }
+    std::sort(encoder.current.begin(), encoder.current.end(), [](const RecordedProcess &a, const RecordedProcess &b) {
+        return a.pid < b.pid;
+    });
+
+    //both tables are sorted, one merge finds the exited, started and changed processes
+    encoder.exited.clear();
+    encoder.changed.clear();
+    size_t exitedCount = 0;
+    size_t changedCount = 0;
+    int lastExited = 0;
+    int lastChanged = 0;
+    const std::vector<RecordedProcess> &previous = encoder.previous;
+    static const RecordedProcess none; //a new process is a change of every field from 0
+    size_t i = 0;
+    for (const RecordedProcess &process : encoder.current) {
+        while (i < previous.size() && previous[i].pid < process.pid) {
+            appendVarint(encoder.exited, previous[i].pid - lastExited);
+            lastExited = previous[i++].pid;
+            exitedCount++;
+        }
+        const RecordedProcess &before = i < previous.size() && previous[i].pid == process.pid ? previous[i++] : none;
+        uint64_t mask = 0;
+        for (int field = 0; field < RECORD_FIELD_COUNT; field++) {
+            mask |= static_cast<uint64_t>(before.fields[field] != process.fields[field]) << field;
+        }
+        if (mask == 0 && &before != &none) {
+            continue;
+        }
+        appendVarint(encoder.changed, process.pid - lastChanged);
+        lastChanged = process.pid;
+        appendVarint(encoder.changed, mask);
+        for (int field = 0; field < RECORD_FIELD_COUNT; field++) {
+            if (mask & (uint64_t{1} << field)) {
+                appendSignedVarint(encoder.changed, process.fields[field] - before.fields[field]);
+            }
+        }
+        changedCount++;
+    }
+    for (; i < previous.size(); i++) {
+        appendVarint(encoder.exited, previous[i].pid - lastExited);
+        lastExited = previous[i].pid;
+        exitedCount++;
+    }
+
+    std::string &payload = encoder.payload;
+    payload.clear();
+    appendSignedVarint(payload, sample.system.cpuTenths);
+    appendSignedVarint(payload, sample.system.maxRam);
+    appendSignedVarint(payload, sample.system.freeRam);
+    appendSignedVarint(payload, sample.system.usedRam);
+    appendVarint(payload, encoder.newStrings.size());
+    for (const std::string_view text : encoder.newStrings) {
+        appendVarint(payload, text.length());
+        payload.append(text);
+    }
+    encoder.newStrings.clear();
+    appendVarint(payload, exitedCount);
+    payload.append(encoder.exited);
+    appendVarint(payload, changedCount);
+    payload.append(encoder.changed);
+    std::swap(encoder.previous, encoder.current);
+}
+
+//the table a recording decodes to, deltas are applied to the one of the record before
+struct RecordState {
+    RecordedSystem system;
+    std::vector<std::string_view> strings; //point into the recording
+    std::vector<RecordedProcess> processes; //sorted by pid
+    std::vector<RecordedProcess> next;
+    std::vector<int> exited;
+};
+
+//applies one record, returns false if the payload is malformed
+bool decodeRecord(RecordState &state, const bool keyframe, const char *data, const size_t size) {
+    const char *end = data + size;
+    if (keyframe) {
+        state.strings.clear();
+        state.processes.clear();
+    }
+    RecordedSystem &system = state.system;
+    if (!readSignedVarint(data, end, system.cpuTenths) || !readSignedVarint(data, end, system.maxRam)
+        || !readSignedVarint(data, end, system.freeRam) || !readSignedVarint(data, end, system.usedRam)) {
+        return false;
+    }
+    uint64_t count;
+    if (!readVarint(data, end, count)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t length;
+        if (!readVarint(data, end, length) || length > static_cast<uint64_t>(end - data)) {
+            return false;
+        }
+        state.strings.emplace_back(data, length);
+        data += length;
+    }
+    if (!readVarint(data, end, count)) {
+        return false;
+    }
+    state.exited.clear();
+    uint64_t pid = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t gap;
+        if (!readVarint(data, end, gap)) {
+            return false;
+        }
+        pid += gap;
+        state.exited.push_back(static_cast<int>(pid));
+    }
+
+    //merges the changes into the old table, dropping the exited processes on the way
+    const std::vector<RecordedProcess> &old = state.processes;
+    size_t i = 0;
+    size_t exited = 0;
+    state.next.clear();
+    auto copyUntil = [&](const uint64_t until) {
+        for (; i < old.size() && static_cast<uint64_t>(old[i].pid) < until; i++) {
+            if (exited < state.exited.size() && state.exited[exited] == old[i].pid) {
+                exited++;
+            }
+            else {
+                state.next.push_back(old[i]);
+            }
+        }
+    };
+    if (!readVarint(data, end, count)) {
+        return false;
+    }
+    pid = 0;
+    for (uint64_t changed = 0; changed < count; changed++) {
+        uint64_t gap;
+        uint64_t mask;
+        if (!readVarint(data, end, gap) || !readVarint(data, end, mask)) {
+            return false;
+        }
+        pid += gap;
+        copyUntil(pid);
+        RecordedProcess process;
+        if (i < old.size() && static_cast<uint64_t>(old[i].pid) == pid) {
+            process = old[i++];
+        }
+        process.pid = static_cast<int>(pid);
+        for (int field = 0; field < RECORD_FIELD_COUNT; field++) {
+            long long difference;
+            if (!(mask & (uint64_t{1} << field))) {
+                continue;
+            }
+            if (!readSignedVarint(data, end, difference)) {
+                return false;
+            }
+            process.fields[field] += difference;
+        }
+        for (const int field : {RECORD_NAME, RECORD_PATH, RECORD_USER}) {
+            if (process.fields[field] < 0 || static_cast<uint64_t>(process.fields[field]) >= state.strings.size()) {
+                return false;
+            }
+        }
+        state.next.push_back(process);
+    }
+    copyUntil(UINT64_MAX);
+    std::swap(state.processes, state.next);
+    return data == end;
+}
+
+//the writing side of a recording file
+struct RecordRing {
+    int fd = -1;
+    uint64_t capacity = 0;
+    uint64_t head = 0;
+    struct Span {
+        uint64_t offset;
+        uint64_t size;
+        bool keyframe;
+    };
+    std::deque<Span> spans; //the readable records, oldest first
+    std::string buffer;
+};
+
+//creates the file with a ring of the capacity, an existing recording is replaced
+bool openRecordRing(RecordRing &ring, const std::string &path, const uint64_t capacity) {
+    ring.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (ring.fd < 0) {
+        return false;
+    }
+    ring.capacity = capacity;
+    RecordingHeader header{};
+    std::memcpy(header.magic, recordingMagic, sizeof(header.magic));
+    header.capacity = capacity;
+    return ftruncate(ring.fd, sizeof(RecordingHeader) + capacity) == 0
+        && pwrite(ring.fd, &header, sizeof(header), 0) == sizeof(header);
+}
+
+//points the file header at the records of the ring
+bool writeRecordingHeader(RecordRing &ring) {
+    RecordingHeader header{};
+    std::memcpy(header.magic, recordingMagic, sizeof(header.magic));
+    header.capacity = ring.capacity;
+    header.tail = ring.spans.empty() ? ring.head : ring.spans.front().offset;
+    header.head = ring.head;
+    header.records = ring.spans.size();
+    return pwrite(ring.fd, &header, sizeof(header), 0) == sizeof(header);
+}
+
+//writes the record at the head and gives up the oldest records it overwrites
+//the header is moved past those records before their bytes are touched, so a crash at any point leaves it
+//pointing at intact records, at worst without the one being written
+//a delta whose keyframe was overwritten can't be decoded anymore, so the ring always starts at a keyframe
+bool appendRecord(RecordRing &ring, const RecordKind kind, const long long time, const std::string &payload) {
+    const uint64_t size = sizeof(RecordHeader) + payload.size();
+    if (size > ring.capacity) {
+        errno = EFBIG;
+        return false;
+    }
+    const uint64_t wrapAt = ring.head;
+    const bool wraps = ring.head + size > ring.capacity;
+    if (wraps) {
+        //the records between the head and the end are the oldest ones
+        while (!ring.spans.empty() && ring.spans.front().offset >= ring.head) {
+            ring.spans.pop_front();
+        }
+        ring.head = 0;
+    }
+    while (!ring.spans.empty() && ring.spans.front().offset < ring.head + size && ring.spans.front().offset + ring.spans.front().size > ring.head) {
+        ring.spans.pop_front();
+    }
+    while (!ring.spans.empty() && !ring.spans.front().keyframe) {
+        ring.spans.pop_front();
+    }
+    if (!writeRecordingHeader(ring)) {
+        return false;
+    }
+
+    if (wraps && ring.capacity - wrapAt >= sizeof(RecordHeader)) {
+        RecordHeader wrap{};
+        wrap.kind = WRAP_RECORD;
+        if (pwrite(ring.fd, &wrap, sizeof(wrap), sizeof(RecordingHeader) + wrapAt) != sizeof(wrap)) {
+            return false;
+        }
+    }
+    RecordHeader header{};
+    header.kind = kind;
+    header.time = time;
+    header.size = static_cast<uint32_t>(payload.size());
+    ring.buffer.assign(reinterpret_cast<const char *>(&header), sizeof(header));
+    ring.buffer.append(payload);
+    if (pwrite(ring.fd, ring.buffer.data(), size, sizeof(RecordingHeader) + ring.head) != static_cast<ssize_t>(size)) {
+        return false;
+    }
+    //a delta is only kept if its keyframe is still there
+    if (kind == KEYFRAME_RECORD || !ring.spans.empty()) {
+        ring.spans.push_back({ring.head, size, kind == KEYFRAME_RECORD});
+    }
+    ring.head += size;
+    return writeRecordingHeader(ring);
+}
+
+//samples waiting for the recorder, more are dropped so a slow disk never holds up the collector
+const size_t maxPendingSamples = 8;
+
+//encodes and writes the samples on its own thread, the collector only copies the table and queues it
+struct Recorder {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::unique_ptr<RecordedSample>> pending;
+    bool stopping = false;
+    RecordRing ring;
+    std::atomic<bool> failed{false};
+    int error = 0; //errno of the failed write, set before failed
+};
+
+std::unique_ptr<RecordedSample> makeRecordedSample(const std::vector<Process> &processes, const Statistics &stats) {
+    auto sample = std::make_unique<RecordedSample>();
+    sample->time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    sample->system = {std::lround(stats.cpuUsage * 10), stats.maxAvailableRam, stats.freeRam, stats.usedRam};
+    sample->processes = processes;
+    sample->pools = holdStringPools();
+    return sample;
+}
+
+void queueSample(Recorder &recorder, std::unique_ptr<RecordedSample> sample) {
+    {
+        std::lock_guard lock(recorder.mutex);
+        if (recorder.pending.size() >= maxPendingSamples) {
+            return;
+        }
+        recorder.pending.push_back(std::move(sample));
+    }
+    recorder.wake.notify_one();
+}
+
+//writes the queued samples until stopped, the ones still queued then are written before it returns
+void runRecorder(Recorder &recorder) {
+    RecordEncoder encoder;
+    while (!recorder.failed) {
+        std::unique_ptr<RecordedSample> sample;
+        {
+            std::unique_lock lock(recorder.mutex);
+            recorder.wake.wait(lock, [&recorder] {
+                return recorder.stopping || !recorder.pending.empty();
+            });
+            if (recorder.pending.empty()) {
+                break;
+            }
+            sample = std::move(recorder.pending.front());
+            recorder.pending.pop_front();
+        }
+        //after a compaction equal strings no longer have equal views, the string ids start over
+        const bool keyframe = recorder.ring.spans.empty() || encoder.sinceKeyframe >= keyframeInterval || sample->pools != encoder.pools;
+        encodeSample(encoder, *sample, keyframe);
+        encoder.pools = sample->pools;
+        if (!appendRecord(recorder.ring, keyframe ? KEYFRAME_RECORD : DELTA_RECORD, sample->time, encoder.payload)) {
+            recorder.error = errno;
+            recorder.failed = true;
+        }
+    }
+}
+
+bool startRecorder(Recorder &recorder, const Options &options) {
+    if (!openRecordRing(recorder.ring, options.record, static_cast<uint64_t>(options.recordSize) * 1024 * 1024)) {
+        recorder.error = errno;
+        return false;
+    }
+    recorder.thread = std::thread(runRecorder, std::ref(recorder));
+    return true;
+}
+
+void stopRecorder(Recorder &recorder) {
+    {
+        std::lock_guard lock(recorder.mutex);
+        recorder.stopping = true;
+    }
+    recorder.wake.notify_one();
+    recorder.thread.join();
+    close(recorder.ring.fd);
+}
+
+//a recording opened for replay, the file is mapped and only the headers of its records are read up front
+//a snapshot is decoded when it is viewed, from the keyframe before it or from the snapshot viewed last
+struct Recording {
+    const char *data = nullptr;
+    size_t length = 0;
+    struct Entry {
+        const char *payload;
+        uint32_t size;
+        bool keyframe;
+        long long time; //milliseconds since the epoch
+    };
+    std::vector<Entry> entries; //oldest first
+    uint64_t dropped = 0; //records from the first damaged one on
+    RecordState state;
+    size_t decoded = SIZE_MAX; //entry the state holds
+};
+
+void closeRecording(Recording &recording) {
+    if (recording.data) {
+        munmap(const_cast<char *>(recording.data), recording.length);
+    }
+    recording.data = nullptr;
+    recording.entries.clear();
+}
+
+//maps the file and lists its records, returns false and the reason if it isn't a readable recording
+bool openRecording(Recording &recording, const std::string &path, std::string &error) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status{};
+    if (fd < 0 || fstat(fd, &status) != 0) {
+        error = strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    recording.length = static_cast<size_t>(status.st_size);
+    void *mapped = recording.length >= sizeof(RecordingHeader) ? mmap(nullptr, recording.length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        error = recording.length >= sizeof(RecordingHeader) ? strerror(errno) : "not a recording";
+        return false;
+    }
+    recording.data = static_cast<const char *>(mapped);
+
+    RecordingHeader header;
+    std::memcpy(&header, recording.data, sizeof(header));
+    if (std::memcmp(header.magic, recordingMagic, sizeof(header.magic)) != 0 || header.capacity > recording.length - sizeof(RecordingHeader)
+        || header.tail > header.capacity || header.head > header.capacity) {
+        error = "not a recording";
+        closeRecording(recording);
+        return false;
+    }
+    const char *ring = recording.data + sizeof(RecordingHeader);
+    uint64_t position = header.tail;
+    for (uint64_t i = 0; i < header.records; i++) {
+        RecordHeader record;
+        //a record that didn't fit before the end of the ring is at its start, after a wrap record or a gap too short for one
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (header.capacity - position < sizeof(RecordHeader)) {
+                position = 0;
+            }
+            std::memcpy(&record, ring + position, sizeof(record));
+            if (record.kind != WRAP_RECORD || position == 0) {
+                break;
+            }
+            position = 0;
+        }
+        const bool known = record.kind == KEYFRAME_RECORD || (record.kind == DELTA_RECORD && i > 0);
+        //the records before a damaged one still replay, the ones after it can't be found
+        if (!known || record.size > header.capacity - position - sizeof(RecordHeader)) {
+            error = "damaged record " + std::to_string(i);
+            recording.dropped = header.records - i;
+            break;
+        }
+        recording.entries.push_back({ring + position + sizeof(RecordHeader), record.size, record.kind == KEYFRAME_RECORD, record.time});
+        position += sizeof(RecordHeader) + record.size;
+    }
+    if (recording.entries.empty()) {
+        if (recording.dropped == 0) {
+            error = "the recording is empty";
+        }
+        closeRecording(recording);
+        return false;
+    }
+    return true;
+}
+
+//decodes the state of one entry, stepping forward only applies the deltas since the entry decoded last
+bool decodeRecordingAt(Recording &recording, const size_t index) {
+    size_t from = index;
+    while (!recording.entries[from].keyframe) {
+        from--;
+    }
+    if (recording.decoded != SIZE_MAX && recording.decoded >= from && recording.decoded <= index) {
+        from = recording.decoded + 1;
+    }
+    for (size_t i = from; i <= index; i++) {
+        const Recording::Entry &entry = recording.entries[i];
+        if (!decodeRecord(recording.state, entry.keyframe, entry.payload, entry.size)) {
+            recording.decoded = SIZE_MAX;
+            return false;
+        }
+    }
+    recording.decoded = index;
+    return true;
+}
+
+//the newest entry at or before the time, the first one if the time is before the recording
+size_t findRecordingEntry(const Recording &recording, const long long time) {
+    const auto after = std::upper_bound(recording.entries.begin(), recording.entries.end(), time, [](const long long time, const Recording::Entry &entry) {
+        return time < entry.time;
+    });
+    return after == recording.entries.begin() ? 0 : after - recording.entries.begin() - 1;
+}
+
+//the local date and time of a record
+std::string formatRecordTime(const long long time) {
+    const time_t seconds = static_cast<time_t>(time / 1000);
+    tm local{};
+    localtime_r(&seconds, &local);
+    char text[32];
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+    return text;
+}
+
+//parses HH:MM or HH:MM:SS into the last time with that clock reading not after latest, in milliseconds since the epoch
+bool parseRecordTime(const std::string_view text, const long long latest, long long &time) {
+    int parts[3] = {0, 0, 0}; //hours, minutes, seconds
+    size_t count = 0;
+    size_t start = 0;
+    while (true) {
+        const size_t end = std::min(text.find(':', start), text.length());
+        if (count == 3 || end == start || std::from_chars(text.data() + start, text.data() + end, parts[count]).ptr != text.data() + end) {
+            return false;
+        }
+        count++;
+        if (end == text.length()) {
+            break;
+        }
+        start = end + 1;
+    }
+    const int hours = parts[0];
+    const int minutes = parts[1];
+    const int seconds = parts[2];
+    if (count < 2 || hours < 0 || hours > 23 || minutes < 0 || minutes > 59 || seconds < 0 || seconds > 59) {
+        return false;
+    }
+    const time_t latestSeconds = static_cast<time_t>(latest / 1000);
+    tm local{};
+    localtime_r(&latestSeconds, &local);
+    local.tm_hour = hours;
+    local.tm_min = minutes;
+    local.tm_sec = seconds;
+    local.tm_isdst = -1;
+    time_t moment = mktime(&local);
+    if (moment > latestSeconds) {
+        local.tm_mday--;
+        local.tm_isdst = -1;
+        moment = mktime(&local);
+    }
+    time = static_cast<long long>(moment) * 1000 + 999;
+    return true;
+}
+
+//what a row of the home screen shows, a slot is only drawn again when this changes
+struct ScreenRow {
+    int pid = 0; //0 for an empty slot
+    int index = 0;
+    int cpuTenths = 0;
+    std::string_view name;
+    ProcessState state = ProcessState::UNKNOWN;
+    int ramUsage = 0;
+    int swapUsage = 0;
+    bool operator==(const ScreenRow &) const = default;
+};
+
+//displays the processes by lines on the home screen
+//shownRows holds what every slot showed in the last frame, slots showing the same process with the same values are left alone
+void displayProcessesLines(const std::vector<Process> &processes, const std::vector<uint32_t> &filteredIndexes, int startline, int endline, int pageNum,
+    std::vector<ScreenRow> &shownRows) {
+    const chtype black = COLOR_PAIR(1);
+    const chtype red = COLOR_PAIR(2);
+    const chtype blue = COLOR_PAIR(3);
+    const chtype green = COLOR_PAIR(4);
+
+    attron(black);
+    attron(A_BOLD);
+    int numLines = 3;
+    shownRows.resize(endline - startline);
+
+    for (int i = 0; i < endline - startline; i++) {
+        int currentIndex = (pageNum * (endline - startline)) + i;
+
+        if (currentIndex >= filteredIndexes.size()) {
+            //the slot showed a process in the last frame
+            if (shownRows[i].pid != 0) {
+                for (int j = 0; j < numLines - 1; j++) {
+                    move(startline + i*numLines + j, 0);
+                    clrtoeol();
+                }
+                shownRows[i] = ScreenRow();
+            }
+            continue;
+        }
+
+        const Process &currentProcess = processes[filteredIndexes[currentIndex]];
+        const ScreenRow row{currentProcess.pid, currentIndex, static_cast<int>(std::lround(currentProcess.cpuUsage * 10)),
+            currentProcess.name, currentProcess.state, currentProcess.ramUsage, currentProcess.swapUsage};
+        if (row == shownRows[i]) {
+            continue;
+        }
+        shownRows[i] = row;
+        for (int j = 0; j < numLines - 1; j++) {
+            mvprintw(startline + i*numLines + j, 0, "%-*s", COLS, " ");
+        }
+        //kb to mb for swap and ram usage
+        float currentRamUsage = currentProcess.ramUsage > 1024 ? static_cast<float>(currentProcess.ramUsage) / 1024 : static_cast<float>(currentProcess.ramUsage);
+        std::string postfixRam = currentProcess.ramUsage > 1024 ? "MB" : "kB";
+        float currentSwapUsage = currentProcess.swapUsage > 1024 ? static_cast<float>(currentProcess.swapUsage) / 1024 : static_cast<float>(currentProcess.swapUsage);
+        std::string postfixSwap = currentProcess.swapUsage > 1024 ? "MB" : "kB";
+
+        //first line
+
+        move(startline + i*numLines, 0);
+        attron(red);
+        printw("[%d] ", i+1);
+
+        attron(black);
+        printw("[%-6d] ", currentProcess.pid);
+        attron(green);
+        printw("[%5.1f%%] ", currentProcess.cpuUsage);
+        attron(red);
+        printw("%.*s", static_cast<int>(currentProcess.name.length()), currentProcess.name.data());
+        attron(black);
+
+        //2nd line
+        move(startline + i*numLines + 1, 0);
+        attron(blue);
+        printw(" Index: %-3d", currentIndex + 1);
+        attron(black);
+        printw(" State: ");
+        attron(green);
+        printw("%-15s", stateDescription(currentProcess.state));
+        attron(black);
+        printw("Usage: ");
+        attron(green);
+        printw("%-8.2f%-4s", currentRamUsage, postfixRam.c_str());
+        attron(black);
+        printw("Swap usage: ");
+        attron(green);
+        if (currentProcess.swapUsage < 0) {
+            //the /stat collector doesn't read swap
+            printw("%-6s", "-");
+        }
+        else {
+            printw("%-6.2f%s", currentSwapUsage, postfixSwap.c_str());
+        }
+    }
+    attroff(A_BOLD);
+    attroff(blue);
+}
+
+void displayRamUsageBar(const long maxRam, const long usedRam) {
+    const std::string ramUsageString = "Ram usage:";
+    printClipped("%s", ramUsageString.c_str());
+    attron(A_BOLD);
+    addch('[');
+    attron(COLOR_PAIR(6));
+    const int allSpaces = COLS * 2 / 3 - ramUsageString.length() - 2;//2 is for []
+    //nothing is known about the memory before the first snapshot
+    const int usedSpaces = maxRam > 0 ? static_cast<int>(static_cast<float>(allSpaces) * (static_cast<float>(usedRam) / static_cast<float>(maxRam))) : 0;
+    for (int i = 0; i < allSpaces; i++) {
+        if (i > usedSpaces) {
+            attron(COLOR_PAIR(8));
+        }
+        addch('|');
+    }
+    attroff(COLOR_PAIR(8));
+    addch(']');
+    attroff(COLOR_PAIR(6));
+    addch('(');
+    attron(COLOR_PAIR(6));
+    printClipped("%.2fGB", static_cast<float>(usedRam) / 1024);
+    attroff(COLOR_PAIR(6));
+    addch('/');
+    attron(COLOR_PAIR(8));
+    printClipped("%.2fGB", static_cast<float>(maxRam) / 1024);
+    attroff(COLOR_PAIR(8));
+    addch(')');
+    addch('\n');
+
+    attroff(A_BOLD);
+}
+
+//displays the home screen
+//an immutable copy of the table, built by the collector thread and read by the ui without locking
+struct Snapshot {
+    std::vector<Process> processes;
+    std::unordered_map<int, size_t> indexByPid;
+    ProcessColumns columns;
+    Statistics stats{};
+    StringPoolHold pools; //empty for a replay, its strings point into the recording
+    bool tracking = false; //the proc connector is open, the counters below are valid
+    unsigned long forks = 0;
+    unsigned long execs = 0;
+    unsigned long exits = 0;
+    double interval = 0; //seconds until the next full scan
+    double scanCost = 0; //cpu seconds of a full scan
+};
+
+//how long the home screen waits for a key before it looks for a new snapshot
+const int snapshotPollMs = 250;
+
+//scans /proc on its own thread, the newest snapshot waits in latest until the ui takes it
+//both sides exchange the pointer, so every snapshot has one owner and nothing is locked on the read path
+struct Collector {
+    std::thread thread;
+    std::atomic<Snapshot *> latest{nullptr};
+    std::atomic<bool> stopping{false};
+    //only for sleeping between scans, the ui takes it when asking for a rescan
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool rescanRequested = false;
+    Recorder *recorder = nullptr; //gets a copy of every snapshot when recording
+};
+
+//spaces the full scans so they take at most the cpu budget, never more often than the target interval
+struct RefreshScheduler {
+    double target; //seconds
+    double budget; //fraction of one core
+    double scanCost = 0; //cpu seconds of a full scan, smoothed
+    double interval;
+};
+
+RefreshScheduler makeRefreshScheduler(const Options &options) {
+    return {options.interval, options.cpuBudget / 100, 0, options.interval};
+}
+
+void recordScanCost(RefreshScheduler &scheduler, const double cpuSeconds) {
+    scheduler.scanCost = scheduler.scanCost == 0 ? cpuSeconds : scheduler.scanCost * 0.7 + cpuSeconds * 0.3;
+    scheduler.interval = std::max(scheduler.target, scheduler.scanCost / scheduler.budget);
+}
+
+std::unique_ptr<Snapshot> makeSnapshot(const ProcessTable &table, const ProcEventTracker &tracker, const bool tracking) {
+    auto snapshot = std::make_unique<Snapshot>();
+    snapshot->processes = table.processes;
+    snapshot->indexByPid = table.indexByPid;
+    buildProcessColumns(snapshot->processes, snapshot->columns);
+    snapshot->stats = getStatistics(snapshot->processes, table.cpuUsage);
+    snapshot->pools = holdStringPools();
+    snapshot->tracking = tracking;
+    snapshot->forks = tracker.forks;
+    snapshot->execs = tracker.execs;
+    snapshot->exits = tracker.exits;
+    return snapshot;
+}
+
+//the snapshot of the entry decoded last, the strings point into the mapped recording
+std::unique_ptr<Snapshot> makeReplaySnapshot(const Recording &recording) {
+    auto snapshot = std::make_unique<Snapshot>();
+    const RecordState &state = recording.state;
+    snapshot->processes.resize(state.processes.size());
+    for (size_t i = 0; i < state.processes.size(); i++) {
+        const auto &fields = state.processes[i].fields;
+        Process &process = snapshot->processes[i];
+        process.pid = state.processes[i].pid;
+        process.ppid = static_cast<int>(fields[RECORD_PPID]);
+        process.name = state.strings[fields[RECORD_NAME]];
+        process.processPath = state.strings[fields[RECORD_PATH]];
+        process.userName = state.strings[fields[RECORD_USER]];
+        process.uid = static_cast<int>(fields[RECORD_UID]);
+        process.state = parseState(static_cast<char>(fields[RECORD_STATE]));
+        process.threads = static_cast<int>(fields[RECORD_THREADS]);
+        process.ramUsage = static_cast<int>(fields[RECORD_RSS]);
+        process.swapUsage = static_cast<int>(fields[RECORD_SWAP]);
+        process.numFileDescriptors = static_cast<int>(fields[RECORD_FDS]);
+        process.cpuUsage = static_cast<float>(fields[RECORD_CPU]) / 10;
+        process.startTime = static_cast<unsigned long long>(fields[RECORD_START]);
+        snapshot->indexByPid[process.pid] = i;
+    }
+    buildProcessColumns(snapshot->processes, snapshot->columns);
+    snapshot->stats = getStatistics(snapshot->processes, static_cast<float>(state.system.cpuTenths) / 10);
+    //the memory of the machine as it was recorded, not as it is now
+    snapshot->stats.maxAvailableRam = state.system.maxRam;
+    snapshot->stats.freeRam = state.system.freeRam;
+    snapshot->stats.usedRam = state.system.usedRam;
+    snapshot->stats.totalRamKb = state.system.maxRam * 1024;
+    snapshot->stats.availableRamKb = state.system.freeRam * 1024;
+    return snapshot;
+}
+
+//hands the snapshot over, one the ui never took is dropped
+void publishSnapshot(Collector &collector, std::unique_ptr<Snapshot> snapshot) {
+    delete collector.latest.exchange(snapshot.release(), std::memory_order_acq_rel);
+}
+
+//the snapshot published since the last call, nullptr if there is none
+std::unique_ptr<Snapshot> takeSnapshot(Collector &collector) {
+    return std::unique_ptr<Snapshot>(collector.latest.exchange(nullptr, std::memory_order_acq_rel));
+}
+
+void requestRescan(Collector &collector) {
+    {
+        std::lock_guard lock(collector.wakeMutex);
+        collector.rescanRequested = true;
+    }
+    collector.wake.notify_one();
+}
+
+//full scans follow the scheduler, with the proc connector events are applied every second in between
+void runCollector(Collector &collector, const Options &options, const int workerCount) {
+    ProcessTable table;
+    ProcEventTracker tracker;
+    const bool tracking = options.events && openProcEventTracker(tracker);
+    RefreshScheduler scheduler = makeRefreshScheduler(options);
+    auto publish = [&] {
+        std::unique_ptr<Snapshot> snapshot = makeSnapshot(table, tracker, tracking);
+        snapshot->interval = scheduler.interval;
+        snapshot->scanCost = scheduler.scanCost;
+        if (collector.recorder) {
+            queueSample(*collector.recorder, makeRecordedSample(table.processes, snapshot->stats));
+        }
+        publishSnapshot(collector, std::move(snapshot));
+    };
+    auto rescan = [&] {
+        //only the collector thread and its scan workers, the ui, recorder and exporter don't count against the budget
+        const double start = threadCpuSeconds();
+        refreshProcessTable(table, workerCount, options.collector);
+        recordScanCost(scheduler, threadCpuSeconds() - start + table.workerCpuSeconds);
+    };
+    rescan();
+    auto lastRescan = std::chrono::steady_clock::now();
+    publish();
+
+    while (true) {
+        const auto nextRescan = lastRescan + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(scheduler.interval));
+        const auto wakeAt = tracking ? std::min(nextRescan, std::chrono::steady_clock::now() + std::chrono::seconds(1)) : nextRescan;
+        bool requested;
+        {
+            std::unique_lock lock(collector.wakeMutex);
+            collector.wake.wait_until(lock, wakeAt, [&collector] {
+                return collector.rescanRequested || collector.stopping.load();
+            });
+            requested = collector.rescanRequested;
+            collector.rescanRequested = false;
+        }
+        if (collector.stopping) {
+            break;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        //between rescans the events only touch the processes they name
+        const bool eventsApplied = tracking && !requested && now < nextRescan
+            && applyProcEvents(table, tracker, options.collector);
+        if (!eventsApplied) {
+            if (tracking) {
+                resetProcEvents(tracker);
+            }
+            rescan();
+            lastRescan = now;
+        }
+        publish();
+    }
+    if (tracking) {
+        close(tracker.fd);
+    }
+}
+
+void startCollector(Collector &collector, const Options &options, const int workerCount) {
+    collector.thread = std::thread(runCollector, std::ref(collector), std::cref(options), workerCount);
+}
+
+void stopCollector(Collector &collector) {
+    {
+        std::lock_guard lock(collector.wakeMutex);
+        collector.stopping = true;
+    }
+    collector.wake.notify_one();
+    collector.thread.join();
+    takeSnapshot(collector);
+}
+
+//replays the recording instead of collecting when it is given, starting at its newest snapshot
+void displayData(const Options &options, Recording *recording = nullptr) {
+    const int workerCount = resolveWorkerCount(options.workers);
+    //the list starts empty and fills in when the collector publishes its first scan
+    Collector collector;
+    std::unique_ptr<Snapshot> snapshot = std::make_unique<Snapshot>();
+    //a replay has no collector, the keys decode the snapshot that is shown next
+    std::unique_ptr<Snapshot> replayed;
+    size_t replayIndex = 0;
+    std::string replayError;
+    std::string timeText;
+    bool enteringTime = false;
+    auto replayAt = [&](const size_t index) {
+        if (decodeRecordingAt(*recording, index)) {
+            replayIndex = index;
+            replayed = makeReplaySnapshot(*recording);
+            replayError.clear();
+        }
+        else {
+            replayError = "damaged snapshot " + std::to_string(index);
+        }
+    };
+    if (recording) {
+        replayAt(recording->entries.size() - 1);
+    }
+    else {
+        startCollector(collector, options, workerCount);
+    }
+    SearchIndex search;
+
+    std::string pageText = "Page: ";
+    int currentPage = 0;
+    int startline = 10;
+    std::vector<std::string> modes = {"ALL", "RUNNING", "SLEEPING", "IDLE", "ZOMBIE", "STOPPED"};
+    std::vector<std::string> sortMode = {"RAM usage", "CPU", "Alphabet", "PID"};
+    int currentModeIndex = 0;
+    int currentUserIndex = 0;
+    int currentSortIndex = 0;
+    //the screen is only erased when something else drew over it, otherwise the frame is drawn over the last one
+    std::vector<ScreenRow> shownRows;
+    int shownHeaderEnd = -1; //last line of the header in the last frame
+    bool redrawAll = true;
+    unsigned long long frameBytes = 0;
+    std::string searchQuery;
+    bool searching = false;
+    //the filter expression is only compiled on enter, the text being edited is kept apart from the running program
+    FilterProgram filter;
+    std::string filterText = options.filter;
+    std::string filterError;
+    bool editingFilter = false;
+    compileFilter(filterText, filter, filterError);
+
+    //filters and sorts are only recomputed when their mode or the snapshot changes, paging reuses the indexes
+    ViewPipeline view;
+    auto setStateStage = [&] {
+        const char state = stateOfMode(modes[currentModeIndex]);
+        setViewStage(view, STATE_STAGE, [state](const ProcessColumns &columns, std::vector<uint32_t> &indexes) {
+            filterColumnsByState(columns, state, indexes);
+        });
+    };
+    auto setUserStage = [&] {
+        if (currentUserIndex == 0) {
+            setViewStage(view, USER_STAGE, nullptr);
+            return;
+        }
+        setViewStage(view, USER_STAGE, [user = snapshot->stats.users[currentUserIndex]](const ProcessColumns &columns, std::vector<uint32_t> &indexes) {
+            filterColumnsByUser(columns, user, indexes);
+        });
+    };
+    auto setFilterStage = [&] {
+        if (filter.instructions.empty()) {
+            setViewStage(view, FILTER_STAGE, nullptr);
+            return;
+        }
+        setViewStage(view, FILTER_STAGE, [program = filter](const ProcessColumns &columns, std::vector<uint32_t> &indexes) {
+            filterColumnsByProgram(columns, program, indexes);
+        });
+    };
+    auto setSearchStage = [&] {
+        if (searchQuery.empty()) {
+            setViewStage(view, SEARCH_STAGE, nullptr);
+            return;
+        }
+        setViewStage(view, SEARCH_STAGE, [&search, query = searchQuery](const ProcessColumns &columns, std::vector<uint32_t> &indexes) {
+            filterColumnsBySearch(columns, search, query, indexes);
+        });
+    };
+    //RAM, name and PID orders barely change between refreshes, so they are kept and repaired instead of sorted again
+    //CPU samples reshuffle the whole order every refresh, that one is sorted per page
+    std::vector<PersistentOrder> orders(3);
+    orders[0].key = SortKey::RAM;
+    orders[1].key = SortKey::NAME;
+    orders[2].key = SortKey::PID;
+    auto updateOrders = [&] {
+        for (auto &order : orders) {
+            updatePersistentOrder(order, snapshot->columns, snapshot->indexByPid);
+        }
+    };
+    auto setSort = [&] {
+        const SortKey key = sortKeyOfMode(sortMode[currentSortIndex]);
+        const auto order = std::find_if(orders.begin(), orders.end(), [key](const PersistentOrder &order) {
+            return order.key == key;
+        });
+        setViewSort(view, key);
+        setViewSource(view, order != orders.end() ? &order->rows : nullptr);
+    };
+    updateOrders();
+    setStateStage();
+    setUserStage();
+    setFilterStage();
+    setSearchStage();
+    setSort();
+
+    while (true) {
+        //a new snapshot replaces the old one, the stages run again over it
+        if (std::unique_ptr<Snapshot> fresh = recording ? std::move(replayed) : takeSnapshot(collector)) {
+            const std::string currentUser = snapshot->stats.users[currentUserIndex];
+            //the search index and the shown rows compare views, after a compaction they start over before the old arenas go
+            if (fresh->pools != snapshot->pools) {
+                search = SearchIndex();
+                shownRows.clear();
+            }
+            snapshot = std::move(fresh);
+            updateOrders();
+            updateSearchIndex(search, snapshot->processes);
+            invalidateView(view);
+            //keep the selected user if it still has processes, and the page unless the user is gone
+            const std::vector<std::string> &users = snapshot->stats.users;
+            const auto user = std::find(users.begin(), users.end(), currentUser);
+            currentUserIndex = user != users.end() ? static_cast<int>(user - users.begin()) : 0;
+            if (user == users.end()) {
+                currentPage = 0;
+            }
+            setUserStage();
+        }
+        const std::vector<Process> &processes = snapshot->processes;
+        const ProcessColumns &columns = snapshot->columns;
+        const Statistics &stats = snapshot->stats;
+
+        if (redrawAll) {
+            erase();
+            shownRows.clear();
+            redrawAll = false;
+        }
+        move(0, 0);
+        printMainQuitInstructions(recording != nullptr);
+        //row for stats under the instructions, lines end with a newline, which clears what the last frame left after them
+        printClipped("Processes: %d, CPU usage: %.1f%%, RAM usage: %ldMB/%ldMB (%ldMB free), last frame: %lluB\n",
+            stats.numProcesses, stats.cpuUsage, stats.usedRam, stats.maxAvailableRam, stats.freeRam, frameBytes);
+        displayRamUsageBar( stats.maxAvailableRam, stats.usedRam);
+
+        if (recording) {
+            printClipped("Running: %d, Sleeping: %d, Stopped: %d, Zombie: %d, Idle: %d, Other: %d, snapshot %zu/%zu at %s",
+                stats.running, stats.sleeping, stats.stopped, stats.zombie, stats.idle, stats.other, replayIndex + 1,
+                recording->entries.size(), formatRecordTime(recording->entries[replayIndex].time).c_str());
+            if (recording->dropped > 0) {
+                printClipped(", %llu damaged dropped", static_cast<unsigned long long>(recording->dropped));
+            }
+            if (enteringTime) {
+                printClipped(", go to (HH:MM[:SS]): %s_", timeText.c_str());
+            }
+            if (!replayError.empty()) {
+                printClipped(" (%s)", replayError.c_str());
+            }
+            printClipped("\n");
+        }
+        else {
+            printClipped("Running: %d, Sleeping: %d, Stopped: %d, Zombie: %d, Idle: %d, Other: %d, Exe path cache hits: %.1f%%, refresh every %.1fs (scan %.0fms cpu)\n",
+                stats.running, stats.sleeping, stats.stopped, stats.zombie, stats.idle, stats.other, exePathHitRate(getExePathCache()),
+                snapshot->interval, snapshot->scanCost * 1000);
+        }
+        if (snapshot->tracking) {
+            printClipped("Since the last rescan: %lu forks, %lu execs, %lu exits\n", snapshot->forks, snapshot->execs, snapshot->exits);
+        }
+
+        //Current filter
+        const size_t stateFiltered = evaluateView(view, columns, STATE_STAGE).size();
+        printClipped("Current filter: ");
+        printModes(modes, currentModeIndex);
+        if (editingFilter || !filter.instructions.empty()) {
+            printClipped(" | %s%s", filterText.c_str(), editingFilter ? "_" : "");
+        }
+        if (!filterError.empty()) {
+            printClipped(" (%s)", filterError.c_str());
+        }
+        printClipped("\nCurrent user: ");
+        printModes(stats.users, currentUserIndex);
+        printClipped("\nCurrent sort mode: ");
+        printModes(sortMode, currentSortIndex);
+        printClipped("\nFiltered ");
+        attron(A_BOLD);
+        attron(COLOR_PAIR(5));
+        printClipped("[%lu]", stateFiltered);
+        attroff(A_BOLD);
+        attroff(COLOR_PAIR(5));
+        printClipped(" processes");
+        if (searching || !searchQuery.empty()) {
+            printClipped(", search: %s%s", searchQuery.c_str(), searching ? "_" : "");
+        }
+        clrtoeol();
+        //the lines are clipped, but the tracking line comes and goes, a header that moved leaves its old last line behind
+        const int headerEnd = getcury(stdscr);
+        if (headerEnd != shownHeaderEnd) {
+            move(headerEnd + 1, 0);
+            clrtobot();
+            shownRows.clear();
+            shownHeaderEnd = headerEnd;
+        }
+
+        //only the rows up to the current page are sorted
+        const std::vector<uint32_t> &filteredIndexes = evaluateSortedView(view, columns, (currentPage + 1) * 9);
+        const int maxPageNum = static_cast<int>(filteredIndexes.size() / 10);
+        //a new snapshot may have fewer pages than the one the page was chosen in
+        currentPage = std::min(currentPage, maxPageNum);
+        const int currentAvailableProcesses = currentPage < maxPageNum ? 9 : filteredIndexes.size() % 9;
+
+        //page count on the right
+        move(0, COLS - pageText.length() - 8);
+        printClipped("%s%d/%d",pageText.c_str(), currentPage, maxPageNum);
+        clrtoeol();
+
+        //display the processes
+        displayProcessesLines(processes, filteredIndexes, startline,  startline + 9, currentPage, shownRows);
+
+        noecho();
+        //the collector's interval is its own, getch only waits long enough to pick up new snapshots quickly
+        //a replay only changes on a key
+        timeout(recording ? -1 : snapshotPollMs);
+        const unsigned long long bytesBefore = terminalBytesWritten();
+        refresh();
+        frameBytes = terminalBytesWritten() - bytesBefore;
+        const int ch = getch();
+        //while searching every key edits the query, enter keeps it and escape drops it
+        if (searching && ch != ERR) {
+            if (ch == '\n' || ch == KEY_ENTER) {
+                searching = false;
+            }
+            else if (ch == 27) {
+                searching = false;
+                searchQuery.clear();
+            }
+            else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
+                if (!searchQuery.empty()) {
+                    searchQuery.pop_back();
+                }
+            }
+            else if (ch >= ' ' && ch <= '~') {
+                searchQuery.push_back(static_cast<char>(ch));
+            }
+            setSearchStage();
+            currentPage = 0;
+        }
+        else if (enteringTime && ch != ERR) {
+            if (ch == '\n' || ch == KEY_ENTER) {
+                long long time;
+                if (parseRecordTime(timeText, recording->entries.back().time, time)) {
+                    enteringTime = false;
+                    replayAt(findRecordingEntry(*recording, time));
+                }
+                else {
+                    replayError = "not a time";
+                }
+            }
+            else if (ch == 27) {
+                enteringTime = false;
+                replayError.clear();
+            }
+            else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
+                if (!timeText.empty()) {
+                    timeText.pop_back();
+                }
+            }
+            else if (ch >= ' ' && ch <= '~') {
+                timeText.push_back(static_cast<char>(ch));
+            }
+        }
+        else if (editingFilter && ch != ERR) {
+            if (ch == '\n' || ch == KEY_ENTER) {
+                FilterProgram compiled;
+                if (compileFilter(filterText, compiled, filterError)) {
+                    filter = std::move(compiled);
+                    filterError.clear();
+                    editingFilter = false;
+                    setFilterStage();
+                    currentPage = 0;
+                }
+            }
+            else if (ch == 27) {
+                editingFilter = false;
+                filterText = filter.text;
+                filterError.clear();
+            }
+            else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
+                if (!filterText.empty()) {
+                    filterText.pop_back();
+                }
+            }
+            else if (ch >= ' ' && ch <= '~') {
+                filterText.push_back(static_cast<char>(ch));
+            }
+        }
+        else if (ch == '~') {
+            break;
+        }
+        else if (ch == 'f') {
+            editingFilter = true;
+        }
+        else if (ch == '/') {
+            searching = true;
+        }
+        else if (ch == 'e') {
+            if (currentPage < maxPageNum) {
+                currentPage ++;
+            }
+        }
+        else if (ch == 'q') {
+            if (currentPage > 0) {
+                currentPage--;
+            }
+        }
+        else if (ch == 'm') {
+            currentModeIndex++;
+            currentModeIndex = currentModeIndex % modes.size();
+            setStateStage();
+            currentPage = 0;
+        }
+        else if (ch == 's') {
+            currentSortIndex++;
+            currentSortIndex = currentSortIndex % sortMode.size();
+            setSort();
+            currentPage = 0;
+        }
+        else if (ch == 'u') {
+            currentUserIndex++;
+            currentUserIndex = currentUserIndex % stats.users.size();
+            setUserStage();
+            currentPage = 0;
+        }
+        else if (ch > '0' && ch <= '9') {
+            int num = ch - '0';
+            if (num <= currentAvailableProcesses) {
+                Process proc = processes[filteredIndexes[currentPage * 9 + num - 1]];
+                if (recording) {
+                    displayRecordedProcessData(proc);
+                }
+                else {
+                    //the detail screen always shows the full /status data, the list may come from /stat
+                    readStatusFile(proc.pid, proc, true);
+                    displaySingleProcessData(proc, workerCount, snapshot->interval > 0 ? snapshot->interval : options.interval);
+                }
+                redrawAll = true;
+            }
+        }
+        else if (ch == KEY_RESIZE) {
+            redrawAll = true;
+        }
+        else if (ch == 'r' && !recording) {
+            requestRescan(collector);
+        }
+        else if (ch == ',' && recording && replayIndex > 0) {
+            replayAt(replayIndex - 1);
+        }
+        else if (ch == '.' && recording && replayIndex + 1 < recording->entries.size()) {
+            replayAt(replayIndex + 1);
+        }
+        else if (ch == 'g' && recording) {
+            enteringTime = true;
+            timeText.clear();
+        }
+    }
+    if (!recording) {
+        stopCollector(collector);
+    }
+}
+
+//length of the utf-8 sequence text starts with, 0 if it doesn't start with a valid one
+//names and paths from /proc are bytes, the formats written from them have to be valid utf-8
+size_t utf8SequenceLength(const std::string_view text) {
+    const auto byte = [&text](const size_t i) {
+        return static_cast<unsigned char>(text[i]);
+    };
+    const unsigned char lead = byte(0);
+    if (lead < 0x80) {
+        return 1;
+    }
+    size_t length;
+    uint32_t codePoint;
+    if (lead >= 0xc2 && lead <= 0xdf) {
+        length = 2;
+        codePoint = lead & 0x1f;
+    }
+    else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        codePoint = lead & 0x0f;
+    }
+    else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        codePoint = lead & 0x07;
+    }
+    else {
+        return 0;
+    }
+    if (text.length() < length) {
+        return 0;
+    }
+    for (size_t i = 1; i < length; i++) {
+        if ((byte(i) & 0xc0) != 0x80) {
+            return 0;
+        }
+        codePoint = codePoint << 6 | (byte(i) & 0x3f);
+    }
+    //overlong forms, surrogates and code points past U+10FFFF
+    const uint32_t smallest[] = {0, 0, 0x80, 0x800, 0x10000};
+    if (codePoint < smallest[length] || (codePoint >= 0xd800 && codePoint <= 0xdfff) || codePoint > 0x10ffff) {
+        return 0;
+    }
+    return length;
+}
+
+//buffered output to a file descriptor for the batch mode, numbers are formatted with to_chars straight into the buffer
+//the buffer is written out whenever it fills, so a snapshot of any size streams through the same 64 KiB
+struct OutputWriter {
+    int fd = STDOUT_FILENO;
+    char buffer[64 * 1024];
+    size_t used = 0;
+    bool failed = false; //the reader went away or the write failed, nothing more is written
+    int error = 0; //errno of the failed write, EPIPE when the reader closed the pipe
+};
+
+void flushOutput(OutputWriter &writer) {
+    size_t written = 0;
+    while (written < writer.used && !writer.failed) {
+        const ssize_t result = write(writer.fd, writer.buffer + written, writer.used - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            writer.failed = true;
+            writer.error = result < 0 ? errno : EIO;
+            break;
+        }
+        written += result;
+    }
+    writer.used = 0;
+}
+
+void writeText(OutputWriter &writer, std::string_view text) {
+    while (!text.empty()) {
+        if (writer.used == sizeof(writer.buffer)) {
+            flushOutput(writer);
+        }
+        const size_t length = std::min(text.size(), sizeof(writer.buffer) - writer.used);
+        memcpy(writer.buffer + writer.used, text.data(), length);
+        writer.used += length;
+        text.remove_prefix(length);
+    }
+}
+
+void writeChar(OutputWriter &writer, const char c) {
+    if (writer.used == sizeof(writer.buffer)) {
+        flushOutput(writer);
+    }
+    writer.buffer[writer.used++] = c;
+}
+
+//integers as they are, floats with one decimal like the ui
+template <typename T>
+void writeNumber(OutputWriter &writer, const T number) {
+    if (sizeof(writer.buffer) - writer.used < 32) {
+        flushOutput(writer);
+    }
+    char *end;
+    if constexpr (std::is_floating_point_v<T>) {
+        end = std::to_chars(writer.buffer + writer.used, writer.buffer + sizeof(writer.buffer), number, std::chars_format::fixed, 1).ptr;
+    }
+    else {
+        end = std::to_chars(writer.buffer + writer.used, writer.buffer + sizeof(writer.buffer), number).ptr;
+    }
+    writer.used = end - writer.buffer;
+}
+
+//bytes that aren't valid utf-8 become U+FFFD, so every line parses as json
+void writeJsonString(OutputWriter &writer, const std::string_view text) {
+    writeChar(writer, '"');
+    for (size_t i = 0; i < text.length();) {
+        const char c = text[i];
+        const size_t length = utf8SequenceLength(text.substr(i));
+        if (c == '"' || c == '\\') {
+            writeChar(writer, '\\');
+            writeChar(writer, c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            writeText(writer, escaped);
+        }
+        else if (length == 0) {
+            writeText(writer, "\\ufffd");
+        }
+        else {
+            writeText(writer, text.substr(i, length));
+            i += length;
+            continue;
+        }
+        i++;
+    }
+    writeChar(writer, '"');
+}
+
+//quoted only when it has to be, quotes inside are doubled
+void writeCsvField(OutputWriter &writer, const std::string_view text) {
+    if (text.find_first_of(",\"\n\r") == std::string_view::npos) {
+        writeText(writer, text);
+        return;
+    }
+    writeChar(writer, '"');
+    for (const char c : text) {
+        if (c == '"') {
+            writeChar(writer, '"');
+        }
+        writeChar(writer, c);
+    }
+    writeChar(writer, '"');
+}
+
+//one line per process, fields the collector could not read are null in json and empty in csv
+void writeProcessRecord(OutputWriter &writer, const OutputFormat format, const int sample, const long long time, const Process &process) {
+    const bool json = format == OutputFormat::JSON;
+    auto key = [&](const char *name, const bool first = false) {
+        if (json) {
+            writeText(writer, first ? "{\"" : ",\"");
+            writeText(writer, name);
+            writeText(writer, "\":");
+        }
+        else if (!first) {
+            writeChar(writer, ',');
+        }
+    };
+    auto optional = [&](const char *name, const int value) {
+        key(name);
+        if (value >= 0) {
+            writeNumber(writer, value);
+        }
+        else if (json) {
+            writeText(writer, "null");
+        }
+    };
+    auto text = [&](const char *name, const std::string_view value) {
+        key(name);
+        json ? writeJsonString(writer, value) : writeCsvField(writer, value);
+    };
+    key("sample", true);
+    writeNumber(writer, sample);
+    key("time");
+    writeNumber(writer, time);
+    key("pid");
+    writeNumber(writer, process.pid);
+    key("ppid");
+    writeNumber(writer, process.ppid);
+    text("name", process.name);
+    const char state = static_cast<char>(process.state);
+    text("state", std::string_view(&state, 1));
+    key("uid");
+    writeNumber(writer, process.uid);
+    text("user", process.userName);
+    key("threads");
+    writeNumber(writer, process.threads);
+    key("cpu");
+    writeNumber(writer, process.cpuUsage);
+    optional("rss_kb", process.ramUsage);
+    optional("swap_kb", process.swapUsage);
+    optional("fds", process.numFileDescriptors);
+    text("path", process.processPath);
+    writeText(writer, json ? "}\n" : "\n");
+}
+
+//takes the samples the interval apart and streams every process of each to stdout, without the ui
+//cpu usage needs two samples, it is 0 in the first one
+//a reader that closes the pipe early, like head, ends the run cleanly, any other failed write returns 1
+int runBatch(const Options &options) {
+    //the closed pipe shows up as EPIPE from write instead of killing the process
+    signal(SIGPIPE, SIG_IGN);
+    const int workerCount = resolveWorkerCount(options.workers);
+    auto writer = std::make_unique<OutputWriter>();
+    if (options.format == OutputFormat::CSV) {
+        writeText(*writer, "sample,time,pid,ppid,name,state,uid,user,threads,cpu,rss_kb,swap_kb,fds,path\n");
+    }
+    ProcessTable table;
+    const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.interval));
+    const auto start = std::chrono::steady_clock::now();
+    for (int sample = 0; sample < options.batch && !writer->failed; sample++) {
+        if (sample > 0) {
+            std::this_thread::sleep_until(start + interval * sample);
+        }
+        refreshProcessTable(table, workerCount, options.collector);
+        const long long time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        for (const Process &process : table.processes) {
+            writeProcessRecord(*writer, options.format, sample, time, process);
+        }
+        //every sample reaches the reader before the wait for the next one
+        flushOutput(*writer);
+    }
+    return writer->failed && writer->error != EPIPE ? 1 : 0;
+}
+
+//appends the number in its shortest form
+template<typename T>
+void appendNumber(std::string &out, const T number) {
+    char text[32];
+    out.append(text, std::to_chars(text, text + sizeof(text), number).ptr);
+}
+
+//a label value, backslashes, quotes and newlines escaped as the prometheus text format wants
+//and bytes that aren't valid utf-8 replaced with U+FFFD like in json
+void appendLabelValue(std::string &out, const std::string_view text) {
+    for (size_t i = 0; i < text.length();) {
+        const char c = text[i];
+        const size_t length = utf8SequenceLength(text.substr(i));
+        if (c == '\\' || c == '"') {
+            out.push_back('\\');
+            out.push_back(c);
+        }
+        else if (c == '\n') {
+            out.append("\\n");
+        }
+        else if (length == 0) {
+            out.append("\xef\xbf\xbd");
+        }
+        else {
+            out.append(text.substr(i, length));
+            i += length;
+            continue;
+        }
+        i++;
+    }
+}
+
+void appendMetricHeader(std::string &out, const std::string_view name, const std::string_view help) {
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n# TYPE ").append(name).append(" gauge\n");
+}
+
+//one sample, labels is the inside of the braces or empty
+template<typename T>
+void appendMetricSample(std::string &out, const std::string_view name, const std::string_view labels, const T value) {
+    out.append(name);
+    if (!labels.empty()) {
+        out.append("{").append(labels).append("}");
+    }
+    out.push_back(' ');
+    appendNumber(out, value);
+    out.push_back('\n');
+}
+
+//the whole http response of a metrics scrape, rendered once per snapshot and sent as it is to every scraper
+//the strings are scratch space kept across snapshots to reuse the allocations
+struct MetricsRenderer {
+    std::string body;
+    std::string labels; //the labels of every process one after another
+    std::vector<size_t> labelEnds;
+};
+
+std::shared_ptr<const std::string> renderMetrics(MetricsRenderer &renderer, const Snapshot &snapshot) {
+    const Statistics &stats = snapshot.stats;
+    std::string &out = renderer.body;
+    out.clear();
+    appendMetricHeader(out, "process_manager_processes", "Processes by state.");
+    const std::pair<const char *, int> states[] = {{"running", stats.running}, {"sleeping", stats.sleeping}, {"stopped", stats.stopped},
+        {"zombie", stats.zombie}, {"idle", stats.idle}, {"other", stats.other}};
+    for (const auto &[state, count] : states) {
+        appendMetricSample(out, "process_manager_processes", std::string("state=\"") + state + "\"", count);
+    }
+    appendMetricHeader(out, "process_manager_cpu_usage_percent", "CPU usage of all cores.");
+    appendMetricSample(out, "process_manager_cpu_usage_percent", "", stats.cpuUsage);
+    appendMetricHeader(out, "process_manager_memory_bytes", "Memory of the machine.");
+    appendMetricSample(out, "process_manager_memory_bytes", "type=\"total\"", stats.totalRamKb * 1024);
+    appendMetricSample(out, "process_manager_memory_bytes", "type=\"free\"", stats.availableRamKb * 1024);
+    appendMetricSample(out, "process_manager_memory_bytes", "type=\"used\"", (stats.totalRamKb - stats.availableRamKb) * 1024);
+    appendMetricHeader(out, "process_manager_scan_cpu_seconds", "CPU time of a full scan of /proc, smoothed.");
+    appendMetricSample(out, "process_manager_scan_cpu_seconds", "", snapshot.scanCost);
+    appendMetricHeader(out, "process_manager_refresh_interval_seconds", "Time between full scans.");
+    appendMetricSample(out, "process_manager_refresh_interval_seconds", "", snapshot.interval);
+
+    //per user totals, unread sizes count as 0
+    struct UserTotals {
+        long long processes = 0;
+        long long rss = 0;
+        long long swap = 0;
+    };
+    std::unordered_map<std::string_view, UserTotals> byUser;
+    for (const Process &process : snapshot.processes) {
+        UserTotals &totals = byUser[process.userName];
+        totals.processes++;
+        totals.rss += std::max(process.ramUsage, 0);
+        totals.swap += std::max(process.swapUsage, 0);
+    }
+    std::vector<std::pair<std::string_view, UserTotals>> users(byUser.begin(), byUser.end());
+    std::sort(users.begin(), users.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+    auto appendUserMetric = [&](const std::string_view name, const std::string_view help, long long UserTotals::*field, const long long scale) {
+        appendMetricHeader(out, name, help);
+        for (const auto &[user, totals] : users) {
+            renderer.labels.assign("user=\"");
+            appendLabelValue(renderer.labels, user);
+            renderer.labels.push_back('"');
+            appendMetricSample(out, name, renderer.labels, totals.*field * scale);
+        }
+    };
+    appendUserMetric("process_manager_user_processes", "Processes of the user.", &UserTotals::processes, 1);
+    appendUserMetric("process_manager_user_rss_bytes", "Resident memory of the processes of the user.", &UserTotals::rss, 1024);
+    appendUserMetric("process_manager_user_swap_bytes", "Swapped out memory of the processes of the user.", &UserTotals::swap, 1024);
+
+    //the labels of every process are escaped once and used by each of its metrics
+    renderer.labels.clear();
+    renderer.labelEnds.clear();
+    for (const Process &process : snapshot.processes) {
+        renderer.labels.append("pid=\"");
+        appendNumber(renderer.labels, process.pid);
+        renderer.labels.append("\",name=\"");
+        appendLabelValue(renderer.labels, process.name);
+        renderer.labels.append("\",user=\"");
+        appendLabelValue(renderer.labels, process.userName);
+        renderer.labels.push_back('"');
+        renderer.labelEnds.push_back(renderer.labels.size());
+    }
+    auto appendProcessMetric = [&](const std::string_view name, const std::string_view help, const auto &value) {
+        appendMetricHeader(out, name, help);
+        size_t start = 0;
+        for (size_t i = 0; i < snapshot.processes.size(); i++) {
+            const std::string_view labels(renderer.labels.data() + start, renderer.labelEnds[i] - start);
+            start = renderer.labelEnds[i];
+            //fields the collector could not read are left out
+            const auto sample = value(snapshot.processes[i]);
+            if (sample >= 0) {
+                appendMetricSample(out, name, labels, sample);
+            }
+        }
+    };
+    appendProcessMetric("process_manager_process_rss_bytes", "Resident memory of the process.", [](const Process &process) {
+        return process.ramUsage < 0 ? -1LL : process.ramUsage * 1024LL;
+    });
+    appendProcessMetric("process_manager_process_swap_bytes", "Swapped out memory of the process.", [](const Process &process) {
+        return process.swapUsage < 0 ? -1LL : process.swapUsage * 1024LL;
+    });
+    appendProcessMetric("process_manager_process_cpu_usage_percent", "CPU usage of the process, percent of one core.", [](const Process &process) {
+        return process.cpuUsage;
+    });
+    appendProcessMetric("process_manager_process_threads", "Threads of the process.", [](const Process &process) {
+        return process.threads;
+    });
+
+    auto response = std::make_shared<std::string>();
+    response->reserve(out.size() + 128);
+    response->append("HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: ");
+    appendNumber(*response, out.size());
+    response->append("\r\nConnection: close\r\n\r\n").append(out);
+    return response;
+}
+
+//a scraper connection, answered once and closed
+struct ExporterClient {
+    int fd;
+    std::chrono::steady_clock::time_point deadline;
+    std::string request;
+    std::shared_ptr<const std::string> response; //set once the request is complete, shared with the other scrapers
+    size_t sent = 0;
+};
+
+//serves the metrics of the newest snapshot over http, on a tcp port or a unix socket
+//it runs on the daemon's thread between the snapshots, a scrape only sends the rendered response and never scans
+struct Exporter {
+    int listenFd = -1;
+    std::string unixPath; //removed again when closed
+    std::shared_ptr<const std::string> metrics; //nullptr until the first snapshot
+    std::vector<ExporterClient> clients;
+};
+
+//connections beyond this wait in the listen backlog
+const size_t maxExporterClients = 64;
+//a scraper that hasn't sent its request or read the response by then is dropped
+const int exporterTimeoutSeconds = 10;
+
+//listens on [HOST:]PORT, host 127.0.0.1 if left out, or on a unix socket if the address is a path
+bool openExporter(Exporter &exporter, const std::string &address, std::string &error) {
+    if (address.find('/') != std::string::npos) {
+        sockaddr_un local{};
+        local.sun_family = AF_UNIX;
+        if (address.length() >= sizeof(local.sun_path)) {
+            error = "socket path too long";
+            return false;
+        }
+        std::memcpy(local.sun_path, address.c_str(), address.length() + 1);
+        //a socket left by an earlier run would fail the bind, it's only removed if nothing listens on it anymore
+        struct stat existing{};
+        if (lstat(address.c_str(), &existing) == 0) {
+            const int probe = S_ISSOCK(existing.st_mode) ? socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) : -1;
+            const bool stale = probe >= 0 && connect(probe, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0 && errno == ECONNREFUSED;
+            if (probe >= 0) {
+                close(probe);
+            }
+            if (!stale) {
+                error = "address in use";
+                return false;
+            }
+            if (unlink(address.c_str()) != 0) {
+                error = strerror(errno);
+                return false;
+            }
+        }
+        exporter.listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (exporter.listenFd < 0 || bind(exporter.listenFd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0) {
+            error = strerror(errno);
+            return false;
+        }
+        exporter.unixPath = address;
+    }
+    else {
+        const size_t colon = address.rfind(':');
+        std::string host = colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+        const std::string port = colon == std::string::npos ? address : address.substr(colon + 1);
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+            host = host.substr(1, host.size() - 2);
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+        addrinfo *found = nullptr;
+        const int result = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found);
+        if (result != 0) {
+            error = gai_strerror(result);
+            return false;
+        }
+        exporter.listenFd = socket(found->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        const int reuse = 1;
+        const bool bound = exporter.listenFd >= 0 && setsockopt(exporter.listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == 0
+            && bind(exporter.listenFd, found->ai_addr, found->ai_addrlen) == 0;
+        freeaddrinfo(found);
+        if (!bound) {
+            error = strerror(errno);
+            return false;
+        }
+    }
+    if (listen(exporter.listenFd, 64) != 0) {
+        error = strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void closeExporter(Exporter &exporter) {
+    for (const ExporterClient &client : exporter.clients) {
+        close(client.fd);
+    }
+    exporter.clients.clear();
+    if (exporter.listenFd >= 0) {
+        close(exporter.listenFd);
+    }
+    if (!exporter.unixPath.empty()) {
+        unlink(exporter.unixPath.c_str());
+    }
+}
+
+void acceptExporterClients(Exporter &exporter) {
+    while (exporter.clients.size() < maxExporterClients) {
+        const int fd = accept4(exporter.listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        exporter.clients.push_back({fd, std::chrono::steady_clock::now() + std::chrono::seconds(exporterTimeoutSeconds), {}, nullptr, 0});
+    }
+}
+
+//reads the request or sends more of the response, returns false once the client is done with
+bool serveExporterClient(const Exporter &exporter, ExporterClient &client) {
+    if (!client.response) {
+        char buffer[1024];
+        ssize_t length;
+        while ((length = recv(client.fd, buffer, sizeof(buffer), 0)) > 0) {
+            client.request.append(buffer, length);
+        }
+        if (length == 0 || (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK) || client.request.size() > 8192) {
+            return false;
+        }
+        if (client.request.find("\r\n\r\n") == std::string::npos && client.request.find("\n\n") == std::string::npos) {
+            return true;
+        }
+        //only the request line matters, the headers are skipped
+        static const auto notFound = std::make_shared<const std::string>(
+            "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\nConnection: close\r\n\r\nnot found\n");
+        const bool metrics = client.request.starts_with("GET /metrics ") || client.request.starts_with("GET / ");
+        if (metrics && !exporter.metrics) {
+            return true; //answered when the first snapshot is rendered
+        }
+        client.response = metrics ? exporter.metrics : notFound;
+    }
+    while (client.sent < client.response->size()) {
+        const ssize_t length = send(client.fd, client.response->data() + client.sent, client.response->size() - client.sent, MSG_NOSIGNAL);
+        if (length < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client.sent += length;
+    }
+    return false;
+}
+
+//serves the clients that are ready, polled holds the daemon's signal fd, the listener and then the clients in order
+void serveExporterClients(Exporter &exporter, const std::vector<pollfd> &polled) {
+    const size_t polledClients = polled.size() - 2;
+    if (polled[1].revents & POLLIN) {
+        acceptExporterClients(exporter);
+    }
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<ExporterClient> &clients = exporter.clients;
+    size_t kept = 0;
+    for (size_t i = 0; i < clients.size(); i++) {
+        ExporterClient &client = clients[i];
+        //the clients accepted just now weren't polled yet, they are tried right away like the ones waiting for the first snapshot
+        const bool ready = i >= polledClients || polled[i + 2].revents != 0 || (!client.response && exporter.metrics);
+        if ((ready && !serveExporterClient(exporter, client)) || now > client.deadline) {
+            close(client.fd);
+            continue;
+        }
+        if (kept != i) {
+            clients[kept] = std::move(client);
+        }
+        kept++;
+    }
+    clients.resize(kept);
+}
+
+//runs the collector without the ui until SIGINT or SIGTERM, recording its snapshots and serving their metrics
+int runDaemon(const Options &options) {
+    //blocked before any thread starts, so they only arrive through the signal fd
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    const int signalFd = signalfd(-1, &signals, SFD_CLOEXEC);
+    if (signalFd < 0) {
+        printf("cannot watch signals: %s\n", strerror(errno));
+        return 1;
+    }
+
+    Exporter exporter;
+    std::string error;
+    if (!options.serve.empty() && !openExporter(exporter, options.serve, error)) {
+        printf("cannot serve on %s: %s\n", options.serve.c_str(), error.c_str());
+        closeExporter(exporter);
+        return 1;
+    }
+    Recorder recorder;
+    if (!options.record.empty() && !startRecorder(recorder, options)) {
+        printf("cannot record to %s: %s\n", options.record.c_str(), strerror(recorder.error));
+        closeExporter(exporter);
+        return 1;
+    }
+    Collector collector;
+    collector.recorder = options.record.empty() ? nullptr : &recorder;
+    startCollector(collector, options, resolveWorkerCount(options.workers));
+
+    MetricsRenderer renderer;
+    std::vector<pollfd> polled;
+    while (!recorder.failed) {
+        polled.assign({{signalFd, POLLIN, 0}, {exporter.listenFd, POLLIN, 0}});
+        for (const ExporterClient &client : exporter.clients) {
+            polled.push_back({client.fd, static_cast<short>(client.response ? POLLOUT : POLLIN), 0});
+        }
+        //woken by the scrapers, and often enough to pick up the snapshots
+        if (poll(polled.data(), polled.size(), snapshotPollMs) < 0 && errno != EINTR) {
+            break;
+        }
+        if (polled[0].revents & POLLIN) {
+            break;
+        }
+        if (std::unique_ptr<Snapshot> snapshot = takeSnapshot(collector); snapshot && exporter.listenFd >= 0) {
+            exporter.metrics = renderMetrics(renderer, *snapshot);
+        }
+        serveExporterClients(exporter, polled);
+    }
+    stopCollector(collector);
+    closeExporter(exporter);
+    close(signalFd);
+    if (options.record.empty()) {
+        return 0;
+    }
+    stopRecorder(recorder);
+    if (recorder.failed) {
+        printf("recording to %s failed: %s\n", options.record.c_str(), strerror(recorder.error));
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * To add:
+ * Process start time
+ * Process running time
+ * Process CPU usage?
+ */
+
+//parses the command line, returns false on invalid arguments
+bool parseOptions(const int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--workers" && i + 1 < argc) {
+            options.workers = std::atoi(argv[++i]);
+            if (options.workers < 1) {
+                return false;
+            }
+        }
+        else if (arg == "--collector" && i + 1 < argc) {
+            const std::string mode = argv[++i];
+            if (mode == "status") {
+                options.collector = CollectorMode::STATUS;
+            }
+            else if (mode == "stat") {
+                options.collector = CollectorMode::STAT;
+            }
+            else {
+                return false;
+            }
+        }
+        else if (arg == "--events") {
+            options.events = true;
+        }
+        else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        }
+        else if (arg == "--batch" && i + 1 < argc) {
+            options.batch = std::atoi(argv[++i]);
+            if (options.batch < 1) {
+                return false;
+            }
+        }
+        else if (arg == "--format" && i + 1 < argc) {
+            const std::string format = argv[++i];
+            if (format == "json") {
+                options.format = OutputFormat::JSON;
+            }
+            else if (format == "csv") {
+                options.format = OutputFormat::CSV;
+            }
+            else {
+                return false;
+            }
+        }
+        else if (arg == "--record" && i + 1 < argc) {
+            options.record = argv[++i];
+        }
+        else if (arg == "--serve" && i + 1 < argc) {
+            options.serve = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc) {
+            options.replay = argv[++i];
+        }
+        else if (arg == "--record-size" && i + 1 < argc) {
+            options.recordSize = std::atoi(argv[++i]);
+            if (options.recordSize < 1) {
+                return false;
+            }
+        }
+        else if (arg == "--interval" && i + 1 < argc) {
+            options.interval = std::atof(argv[++i]);
+            if (options.interval <= 0) {
+                return false;
+            }
         }
-    };
-    attroff(COLOR_PAIR(2));
-    bkgd(COLOR_PAIR(0));
+        else if (arg == "--cpu-budget" && i + 1 < argc) {
+            options.cpuBudget = std::atof(argv[++i]);
+            if (options.cpuBudget <= 0 || options.cpuBudget > 100) {
+                return false;
+            }
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
 }
 
-//helper function for the printMainQuitInstructions, prints 1st in normal, 2nd in bold, takes colors
-void printPair(std::string text1, std::string text2, chtype color1, chtype color2) {
-    attron(color1);
-    printw("%s", text1.c_str());
-    attroff(color1);
-    attron(A_BOLD);
-    attron(color2);
-    printw("%s", text2.c_str());
-    attroff(A_BOLD);
-    attroff(color2);
+#ifdef PROCESS_MANAGER_BENCHMARK
+//heap allocations so far, counted by the operator new of the benchmark build
+std::atomic<unsigned long> allocationCount{0};
+
+void *operator new(const size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
 }
 
-//quit instruction for home screen
-void printMainQuitInstructions() {
-    init_pair(20, COLOR_GREEN, COLOR_BLACK);
-    chtype color = COLOR_PAIR(20);
-    chtype normal = COLOR_PAIR(0);
-    printPair("QUIT->", "[~]", normal, color);
-    printPair(" MODE->", "[M]", normal, color);
-    printPair(" SELECT->", "[NUMBER]", normal, color);
-    printPair(" USER->", "[U]", normal, color);
-    printPair(" SORT->", "[S]", normal, color);
+void *operator new[](const size_t size) {
+    return operator new(size);
 }
 
-//helper for sort, by RAM descending
-bool compareProcessesByRAM(const Process &process1, const Process &process2) {
-    return process1.ramUsage > process2.ramUsage;
+//not inlined, gcc would otherwise pair the free with the new expressions it gets inlined into and warn
+[[gnu::noinline]] void operator delete(void *memory) noexcept {
+    std::free(memory);
 }
 
-//helper for sort, by name alphabetically
-bool compareProcessesByName(const Process &process1, const Process &process2) {
-    return process1.name < process2.name;
+void operator delete[](void *memory) noexcept {
+    operator delete(memory);
 }
 
-//helper for sort, by PID ascending
-bool compareProcessesByPID(const Process &process1, const Process &process2) {
-    return process1.pid < process2.pid;
+void operator delete(void *memory, size_t) noexcept {
+    operator delete(memory);
 }
 
-//sorts by the current selected mode
-void sortProcesses(std::vector<Process> &processes, std::string mode) {
-    if (mode == "RAM usage") {
-        std::sort(processes.begin(), processes.end(), compareProcessesByRAM);
-    }
-    if (mode == "Alphabet") {
-        std::sort(processes.begin(), processes.end(), compareProcessesByName);
-        return;
-    }
-    if (mode == "PID") {
-        std::sort(processes.begin(), processes.end(), compareProcessesByPID);
-        return;
+void operator delete[](void *memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+//makes rows of fake processes for the benchmarks
+std::vector<Process> makeSyntheticProcesses(const size_t count) {
+    const std::vector<std::string_view> users = {"root", "www", "app", "postgres", "nobody"};
+    const std::vector<std::string> names = {"java", "postgres", "nginx", "bash", "python3", "kworker/0:1", "systemd", "sshd"};
+    const std::vector<ProcessState> states = {ProcessState::SLEEPING, ProcessState::RUNNING, ProcessState::IDLE, ProcessState::ZOMBIE, ProcessState::STOPPED};
+    std::mt19937 random(42);
+    std::vector<Process> processes(count);
+    for (size_t i = 0; i < count; i++) {
+        Process &process = processes[i];
+        process.pid = static_cast<int>(i + 1);
+        process.ppid = static_cast<int>(random() % (i + 1));
+        setProcessName(process, names[random() % names.size()] + std::to_string(i % 100));
+        process.state = states[random() % 8 < 5 ? 0 : random() % states.size()];
+        process.ramUsage = static_cast<int>(random() % (4 * 1024 * 1024));
+        process.swapUsage = static_cast<int>(random() % 1024);
+        process.cpuUsage = static_cast<float>(random() % 1000) / 10;
+        process.uid = static_cast<int>(random() % users.size());
+        process.userName = users[process.uid];
+        process.processPath = internString(getNamePool(), "/usr/bin/" + std::string(process.name));
     }
+    return processes;
 }
 
-//displays the processes by lines on the home screen
-void displayProcessesLines(const std::vector<Process> &filteredProcesses, int startline, int endline, int pageNum) {
-    const chtype black = COLOR_PAIR(1);
-    const chtype red = COLOR_PAIR(2);
-    const chtype blue = COLOR_PAIR(3);
-    const chtype green = COLOR_PAIR(4);
+//the old ifstream based /status parser, only kept as the reference for the parser stage
+bool readStatusFileIfstream(const int pid, Process &process, const bool dynamicOnly) {
+    std::string status = "/proc/" + std::to_string(pid) + "/status";
+    std::string nameFlag = "Name:";
+    std::string pidFlag = "Pid:";
+    std::string ppidFlag = "PPid:";
+    std::string ramUsageFlag = "VmRSS:";
+    std::string swapUsageFlag = "VmSwap:";
+    std::string stateFlag = "State:";
+    std::string fileDescriptorCountFlag = "FDSize:";
+    std::string uidFlag = "Uid:";
+    std::string line;
 
-    attron(black);
-    attron(A_BOLD);
-    int numLines = 3;
+    std::ifstream file;
+    file.open(status);
+    if (!file) {
+        //the process exited between listing /proc and opening it
+        return false;
+    }
+    //kernel threads have no memory lines, don't keep the values of the last refresh
+    process.ramUsage = -1;
+    process.swapUsage = -1;
 
-    for (int i = 0; i < endline - startline; i++) {
-        int currentIndex = (pageNum * (endline - startline)) + i;
+    while (std::getline(file, line)) {
 
-        if (filteredProcesses.empty()) {
-            attroff(black);
-            attroff(A_BOLD);
-            return;
+        if (line.substr(0, nameFlag.length()) == nameFlag) {
+            if (!dynamicOnly) {
+                setProcessName(process, parseData(line, nameFlag));
+            }
         }
-        if (currentIndex >= filteredProcesses.size()) {
-            attroff(black);
-            attroff(A_BOLD);
-            return;
+        else if (line.substr(0, pidFlag.length()) == pidFlag) {
+            if (!dynamicOnly) {
+                process.pid = std::stoi(parseData(line, pidFlag));
+            }
         }
-
-        for (int j = 0; j < numLines - 1; j++) {
-            mvprintw(startline + i*numLines + j, 0, "%-*s", COLS, " ");
+        else if (line.substr(0, ppidFlag.length()) == ppidFlag) {
+            process.ppid = std::stoi(parseData(line, ppidFlag));
+        }
+        else if (line.substr(0, ramUsageFlag.length()) == ramUsageFlag) {
+            process.ramUsage = std::stoi(parseData(line, ramUsageFlag));
+        }
+        else if (line.substr(0, swapUsageFlag.length()) == swapUsageFlag) {
+            process.swapUsage = std::stoi(parseData(line, swapUsageFlag));
+        }
+        else if (line.substr(0, stateFlag.length()) == stateFlag) {
+            process.state = parseState(parseData(line, stateFlag)[0]);
+        }
+        else if (line.substr(0, fileDescriptorCountFlag.length()) == fileDescriptorCountFlag) {
+            process.numFileDescriptors = std::stoi(parseData(line, fileDescriptorCountFlag));
+        }
+        else if (line.substr(0, uidFlag.length()) == uidFlag) {
+            process.uid = std::stoi(parseData(line, uidFlag));
         }
-        const Process &currentProcess = filteredProcesses[currentIndex];
-        //kb to mb for swap and ram usage
-        float currentRamUsage = currentProcess.ramUsage > 1024 ? static_cast<float>(currentProcess.ramUsage) / 1024 : static_cast<float>(currentProcess.ramUsage);
-        std::string postfixRam = currentProcess.ramUsage > 1024 ? "MB" : "kB";
-        float currentSwapUsage = currentProcess.swapUsage > 1024 ? static_cast<float>(currentProcess.swapUsage) / 1024 : static_cast<float>(currentProcess.swapUsage);
-        std::string postfixSwap = currentProcess.swapUsage > 1024 ? "MB" : "kB";
-
-        //first line
-
-        move(startline + i*numLines, 0);
-        attron(red);
-        printw("[%d] ", i+1);
-
-        attron(black);
-        printw("[%-6d] ", currentProcess.pid);
-        attron(red);
-        printw("%s", currentProcess.name.c_str());
-        attron(black);
-
-        //2nd line
-        move(startline + i*numLines + 1, 0);
-        attron(blue);
-        printw(" Index: %-3d", currentIndex + 1);
-        attron(black);
-        printw(" State: ");
-        attron(green);
-        printw("%-15s", currentProcess.state.c_str());
-        attron(black);
-        printw("Usage: ");
-        attron(green);
-        printw("%-8.2f%-4s", currentRamUsage, postfixRam.c_str());
-        attron(black);
-        printw("Swap usage: ");
-        attron(green);
-        printw("%-6.2f%s", currentSwapUsage, postfixSwap.c_str());
     }
-    attroff(A_BOLD);
-    attroff(blue);
+    file.close();
+    return true;
 }
 
-void displayRamUsageBar(const long maxRam, const long usedRam) {
-    const std::string ramUsageString = "Ram usage:";
-    printw("%s", ramUsageString.c_str());
-    attron(A_BOLD);
-    addch('[');
-    attron(COLOR_PAIR(6));
-    const int allSpaces = COLS * 2 / 3 - ramUsageString.length() - 2;//2 is for []
-    const int usedSpaces = static_cast<int>(static_cast<float>(allSpaces) * (static_cast<float>(usedRam) / static_cast<float>(maxRam)));
-    for (int i = 0; i < allSpaces; i++) {
-        if (i > usedSpaces) {
-            attron(COLOR_PAIR(8));
-        }
-        addch('|');
+//runs work once per refresh and prints its time per item, p50 and p99 per refresh and the allocations per refresh
+//prepare runs before every refresh outside the timing, a first untimed refresh fills the caches like a running ui has them
+template<typename Prepare, typename Work>
+void timeStage(const char *name, const size_t items, const int refreshes, const Prepare &prepare, const Work &work) {
+    std::vector<double> samples;
+    unsigned long allocations = 0;
+    prepare();
+    work();
+    for (int refresh = 0; refresh < refreshes; refresh++) {
+        prepare();
+        const unsigned long allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+        work();
+        const auto end = std::chrono::steady_clock::now();
+        allocations += allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+        samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
     }
-    attroff(COLOR_PAIR(8));
-    addch(']');
-    attroff(COLOR_PAIR(6));
-    addch('(');
-    attron(COLOR_PAIR(6));
-    printw("%.2fGB", static_cast<float>(usedRam) / 1024);
-    attroff(COLOR_PAIR(6));
-    addch('/');
-    attron(COLOR_PAIR(8));
-    printw("%.2fGB", static_cast<float>(maxRam) / 1024);
-    attroff(COLOR_PAIR(8));
-    addch(')');
-    addch('\n');
-
-    attroff(A_BOLD);
+    double total = 0;
+    for (const double sample : samples) {
+        total += sample;
+    }
+    std::sort(samples.begin(), samples.end());
+    const double p50 = samples[samples.size() / 2];
+    const double p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    printf("  %-22s %12.1f %12.1f %12.1f %14.1f\n", name, total / refreshes / items, p50 / 1000, p99 / 1000,
+        static_cast<double>(allocations) / refreshes);
 }
 
-//displays the home screen
-void displayData() {
-    std::vector<Process> processes = getProcesses();
-    const Statistics stats = getStatistics(processes);
-
-    std::string pageText = "Page: ";
-    int currentPage = 0;
-    int startline = 9;
-    std::vector<std::string> modes = {"ALL", "RUNNING", "SLEEPING", "IDLE", "ZOMBIE", "STOPPED"};
-    std::vector<std::string> sortMode = {"RAM usage", "Alphabet", "PID"};
-    int currentModeIndex = 0;
-    int currentUserIndex = 0;
-    int currentSortIndex = 0;
-
-    while (true) {
-        printMainQuitInstructions();
-        //top row for stats
-        mvprintw(1, 0, "Processes: %d, RAM usage: %ldMB/%ldMB (%ldMB free)\n",
-            stats.numProcesses, stats.usedRam, stats.maxAvailableRam, stats.freeRam);
-        displayRamUsageBar( stats.maxAvailableRam, stats.usedRam);
-
-        printw("Running: %d, Sleeping: %d, Stopped: %d, Zombie: %d, Idle: %d, Other: %d\n",
-            stats.running, stats.sleeping, stats.stopped, stats.zombie, stats.idle, stats.other);
-
-        //Current filter
-        std::vector<Process> filteredProcesses = filterProcessesStatus(processes, modes[currentModeIndex]);
-        printw("Current filter: ");
-        printModes(modes, currentModeIndex);
-        printw("\nCurrent user: ");
-        printModes(stats.users, currentUserIndex);
-        printw("\nCurrent sort mode: ");
-        printModes(sortMode, currentSortIndex);
-        printw("\nFiltered ");
-        attron(A_BOLD);
-        attron(COLOR_PAIR(5));
-        printw("[%lu]", filteredProcesses.size());
-        attroff(A_BOLD);
-        attroff(COLOR_PAIR(5));
-        printw(" processes");
+template<typename Work>
+void timeStage(const char *name, const size_t items, const int refreshes, const Work &work) {
+    timeStage(name, items, refreshes, [] {}, work);
+}
 
-        filteredProcesses = filterProcessesUser(filteredProcesses, stats.users[currentUserIndex]);
-        const int maxPageNum = static_cast<int>(filteredProcesses.size() / 10);
-        const int currentAvailableProcesses = currentPage < maxPageNum ? 9 : filteredProcesses.size() % 9;
-        sortProcesses(filteredProcesses, sortMode[currentSortIndex]);
+void printStageHeader() {
+    printf("  %-22s %12s %12s %12s %14s\n", "stage", "ns/process", "p50 us", "p99 us", "allocs/refresh");
+}
 
-        //page count on the right
-        move(0, COLS - pageText.length() - 7);
-        printw("%s%d/%d",pageText.c_str(), currentPage, maxPageNum);
+//times full scans of the live processes with a growing number of workers, then the incremental refreshes with all of them
+void runScanBenchmark(const int maxWorkers, const int refreshes) {
+    std::vector<int> livePids;
+    enumeratePids(livePids);
+    if (livePids.empty()) {
+        printf("no processes in /proc\n");
+        return;
+    }
+    printf("%zu live processes, up to %d workers, %d refreshes\n", livePids.size(), maxWorkers, refreshes);
+    printStageHeader();
+    for (int workers = 1;; workers = std::min(workers * 2, maxWorkers)) {
+        const std::string name = "scan, " + std::to_string(workers) + (workers == 1 ? " worker" : " workers");
+        timeStage(name.c_str(), livePids.size(), refreshes, [&] {
+            getProcesses(workers);
+        });
+        if (workers == maxWorkers) {
+            break;
+        }
+    }
+    for (const CollectorMode mode : {CollectorMode::STATUS, CollectorMode::STAT}) {
+        ProcessTable table;
+        timeStage(mode == CollectorMode::STAT ? "refresh from /stat" : "refresh from /status", livePids.size(), refreshes, [&] {
+            refreshProcessTable(table, maxWorkers, mode);
+        });
+    }
+    printf("  exe path cache hits: %.1f%%\n", exePathHitRate(getExePathCache()));
+}
 
-        //display the processes
-        displayProcessesLines(filteredProcesses, startline,  startline + 9, currentPage);
+//times every stage of a refresh on one thread, prints to terminal
+//the /proc stages go round the live processes until count were read, the others run on count synthetic processes
+void runStageBenchmark(const size_t count, const int refreshes) {
+    std::vector<int> livePids;
+    enumeratePids(livePids);
+    if (livePids.empty()) {
+        printf("no processes in /proc\n");
+        return;
+    }
+    std::vector<int> pids(count);
+    std::vector<int> uids(count);
+    std::vector<unsigned long long> startTimes(count);
+    Process process;
+    for (size_t i = 0; i < count; i++) {
+        pids[i] = livePids[i % livePids.size()];
+        StatFields fields;
+        readStatFields(pids[i], fields);
+        startTimes[i] = fields.startTime;
+        readStatusFile(pids[i], process, false);
+        uids[i] = process.uid;
+    }
+    printf("%zu processes (%zu live ones in /proc), %d refreshes, a Process is %zu bytes\n", count, livePids.size(), refreshes, sizeof(Process));
+    printStageHeader();
 
-        noecho();
-        refresh();
-        char ch = getch();
-        if (ch == '~') {
-            break;
+    std::vector<int> listed;
+    timeStage("enumerate", count, refreshes, [&] {
+        for (size_t found = 0; found < count; found += listed.size()) {
+            enumeratePids(listed);
         }
-        if (ch == 'e') {
-            if (currentPage < maxPageNum) {
-                currentPage ++;
-            }
+    });
+    timeStage("parse /status", count, refreshes, [&] {
+        for (const int pid : pids) {
+            readStatusFile(pid, process, false);
         }
-        else if (ch == 'q') {
-            if (currentPage > 0) {
-                currentPage--;
-            }
+    });
+    timeStage("parse /status (ifstream)", count, refreshes, [&] {
+        for (const int pid : pids) {
+            readStatusFileIfstream(pid, process, false);
         }
-        else if (ch == 'm') {
-            currentModeIndex++;
-            currentModeIndex = currentModeIndex % modes.size();
-            currentPage = 0;
+    });
+    timeStage("parse /stat", count, refreshes, [&] {
+        for (const int pid : pids) {
+            readStatFile(pid, process, false);
         }
-        else if (ch == 's') {
-            currentSortIndex++;
-            currentSortIndex = currentSortIndex % sortMode.size();
-            currentPage = 0;
+    });
+    timeStage("user lookup", count, refreshes, [&] {
+        for (const int uid : uids) {
+            process.userName = lookupUsername(getUserCache(), uid);
         }
-        else if (ch == 'u') {
-            currentUserIndex++;
-            currentUserIndex = currentUserIndex % stats.users.size();
-            currentPage = 0;
+    });
+    timeStage("user lookup (nss)", count, refreshes, [&] {
+        for (const int uid : uids) {
+            uidToUsername(uid);
         }
-        else if (ch > '0' && ch <= '9') {
-            int num = ch - '0';
-            if (num <= currentAvailableProcesses) {
-                Process proc = filteredProcesses[currentPage * 9 + num - 1];
-                displaySingleProcessData(proc);
-            }
+    });
+    timeStage("exe path (cache)", count, refreshes, [&] {
+        for (size_t i = 0; i < count; i++) {
+            process.processPath = lookupExePath(getExePathCache(), pids[i], startTimes[i], process.name);
         }
-        else {
-            processes = getProcesses();
-            getStatistics(processes);
-            std::sort(processes.begin(), processes.end(), compareProcessesByRAM);
-            currentPage = 0;
+    });
+    timeStage("exe readlink", count, refreshes, [&] {
+        for (const int pid : pids) {
+            getProcessPath(pid);
+        }
+    });
+
+    const std::vector<Process> processes = makeSyntheticProcesses(count);
+    ProcessColumns columns;
+    std::vector<uint32_t> indexes;
+    timeStage("build columns", count, refreshes, [&] {
+        buildProcessColumns(processes, columns);
+    });
+    timeStage("stats", count, refreshes, [&] {
+        getStatistics(processes);
+    });
+    timeStage("filter", count, refreshes, [&] {
+        filterProcessesStatus(processes, "SLEEPING");
+    });
+    timeStage("filter (columns)", count, refreshes, [&] {
+        allColumnIndexes(columns, indexes);
+    }, [&] {
+        filterColumnsByState(columns, 'S', indexes);
+    });
+    std::vector<Process> sorted;
+    timeStage("sort", count, refreshes, [&] {
+        sorted = processes;
+    }, [&] {
+        sortProcesses(sorted, "RAM usage");
+    });
+    timeStage("sort (columns)", count, refreshes, [&] {
+        allColumnIndexes(columns, indexes);
+    }, [&] {
+        sortColumnIndexes(columns, indexes, SortKey::RAM);
+    });
+    //a sort change only sorts the first page of the filtered rows
+    ViewPipeline view;
+    setViewStage(view, STATE_STAGE, nullptr);
+    timeStage("sort (first page)", count, refreshes, [&] {
+        setViewSort(view, SortKey::RAM);
+        evaluateSortedView(view, columns, 9);
+    });
+    FilterProgram program;
+    std::string error;
+    compileFilter("rss > 500M and user in (www, app) and state in (R, S) and name ~ \"JAVA\" or pid < 100", program, error);
+    timeStage("filter expression", count, refreshes, [&] {
+        allColumnIndexes(columns, indexes);
+    }, [&] {
+        filterColumnsByProgram(columns, program, indexes);
+    });
+    SearchIndex search;
+    updateSearchIndex(search, processes);
+    timeStage("search", count, refreshes, [&] {
+        allColumnIndexes(columns, indexes);
+    }, [&] {
+        filterColumnsBySearch(columns, search, "bin/postgres4", indexes);
+    });
+    //the render below shows the rows sorted by RAM
+    allColumnIndexes(columns, indexes);
+    sortColumnIndexes(columns, indexes, SortKey::RAM);
+
+    //the first page drawn from nothing, like after a resize, on a terminal that writes to /dev/null
+    FILE *output = fopen("/dev/null", "w");
+    FILE *input = fopen("/dev/null", "r");
+    const char *term = getenv("TERM");
+    SCREEN *screen = output && input ? newterm(term ? term : "xterm", output, input) : nullptr;
+    if (screen) {
+        start_color();
+        for (short pair = 1; pair <= 4; pair++) {
+            init_pair(pair, COLOR_BLACK, COLOR_WHITE);
+        }
+        std::vector<ScreenRow> shownRows;
+        timeStage("render (per row)", 9, refreshes, [&] {
+            shownRows.clear();
+            erase();
+        }, [&] {
+            displayProcessesLines(processes, indexes, 9, 18, 0, shownRows);
             refresh();
+        });
+        endwin();
+        delscreen(screen);
+    }
+    else {
+        printf("  render skipped, no terminal description for %s\n", term ? term : "xterm");
+    }
+    if (output) {
+        fclose(output);
+    }
+    if (input) {
+        fclose(input);
+    }
+}
+
+//parses a comma separated list of process counts
+bool parseCounts(const std::string_view text, std::vector<size_t> &counts) {
+    counts.clear();
+    size_t start = 0;
+    while (start <= text.length()) {
+        const size_t end = std::min(text.find(',', start), text.length());
+        size_t count = 0;
+        if (std::from_chars(text.data() + start, text.data() + end, count).ptr != text.data() + end || count == 0) {
+            return false;
         }
-        clear();
+        counts.push_back(count);
+        start = end + 1;
     }
+    return true;
 }
 
-/*
- * To add:
- * Process start time
- * Process running time
- * Process CPU usage?
- * Search bar
- */
+//the benchmark build runs the scan and stage benchmarks instead of the ui
+int main(int argc, char *argv[]) {
+    std::vector<size_t> counts = {1000, 10000};
+    int refreshes = 50;
+    int workers = resolveWorkerCount(0);
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--processes" && i + 1 < argc && parseCounts(argv[++i], counts)) {
+            continue;
+        }
+        if (arg == "--refreshes" && i + 1 < argc && (refreshes = std::atoi(argv[++i])) > 0) {
+            continue;
+        }
+        if (arg == "--workers" && i + 1 < argc && (workers = std::atoi(argv[++i])) > 0) {
+            continue;
+        }
+        printf("usage: %s [--processes N[,N...]] [--refreshes N] [--workers N]\n", argv[0]);
+        return 1;
+    }
+    runScanBenchmark(workers, refreshes);
+    for (const size_t count : counts) {
+        runStageBenchmark(count, refreshes);
+    }
+    return 0;
+}
+#else
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printf("usage: %s [--workers N] [--collector status|stat] [--events] [--filter EXPRESSION] [--interval SECONDS] [--cpu-budget PERCENT]\n"
+            "       [--batch N [--format json|csv]] [--record FILE [--record-size MB]] [--replay FILE]\n"
+            "       [--serve [HOST:]PORT|SOCKET]\n", argv[0]);
+        return 1;
+    }
+    FilterProgram filter;
+    std::string filterError;
+    if (!options.filter.empty() && !compileFilter(options.filter, filter, filterError)) {
+        printf("invalid filter: %s\n", filterError.c_str());
+        return 1;
+    }
+    if (options.batch > 0) {
+        return runBatch(options);
+    }
+    if (!options.record.empty() || !options.serve.empty()) {
+        return runDaemon(options);
+    }
+    Recording recording;
+    std::string recordingError;
+    if (!options.replay.empty() && !openRecording(recording, options.replay, recordingError)) {
+        printf("cannot replay %s: %s\n", options.replay.c_str(), recordingError.c_str());
+        return 1;
+    }
 
-int main() {
     initscr();
     curs_set(0); //no cursor
     start_color();
@@ -747,10 +5090,12 @@ int main() {
     init_pair(7, COLOR_WHITE, COLOR_BLUE);
     init_pair(8, COLOR_GREEN, COLOR_BLACK);
     nodelay(stdscr, TRUE);
-    timeout(5000); //time to auto refresh
+    timeout(snapshotPollMs); //the screens wait this long for a key, the collector refreshes on its own
 
-    displayData();
+    displayData(options, options.replay.empty() ? nullptr : &recording);
 
     endwin();
+    closeRecording(recording);
     return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file